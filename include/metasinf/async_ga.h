@@ -0,0 +1,248 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_ASYNC_GA_H_
+#define METASINF_INCLUDE_METASINF_ASYNC_GA_H_
+
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "metasinf/parallel.h"
+#include "metasinf/delta.h"
+#include "metasinf/population.h"
+
+namespace snf {
+
+/// Asynchronous steady-state genetic algorithm.
+///
+/// A fixed number of offspring are evaluated concurrently on worker threads.
+/// Whenever an evaluation completes, the offspring is inserted into the
+/// population with the replacement functor and a new offspring is bred and
+/// dispatched immediately, so there is no generational barrier. Offspring
+/// that are exact copies of their parents are inserted without being
+/// evaluated.
+///
+/// The replacement functor receives one offspring at a time and should keep
+/// the population size constant, e.g. `ReplacementWorst`. The termination
+/// functor is checked after every insertion. The evaluation functor is
+/// invoked from multiple threads and must be thread-safe.
+template <
+    typename EvaluationFunc,
+    typename SelectionFunc,
+    typename CrossoverFunc,
+    typename MutationFunc,
+    typename ReplacementFunc,
+    typename TerminationFunc>
+struct AsyncGa {
+  /// Construct a new simulation.
+  AsyncGa(size_t thread_count, double mutation_rate, double crossover_rate,
+          const EvaluationFunc& evaluation = EvaluationFunc(),
+          const SelectionFunc& selection = SelectionFunc(),
+          const CrossoverFunc& crossover = CrossoverFunc(),
+          const MutationFunc& mutation = MutationFunc(),
+          const ReplacementFunc& replacement = ReplacementFunc(),
+          const TerminationFunc& termination = TerminationFunc())
+      : thread_count(thread_count),
+        mutation_rate(mutation_rate),
+        crossover_rate(crossover_rate),
+        evaluation(evaluation),
+        selection(selection),
+        crossover(crossover),
+        mutation(mutation),
+        replacement(replacement),
+        termination(termination) {}
+
+  /// Number of evaluations in flight.
+  size_t thread_count;
+
+  /// Mutation rate.
+  double mutation_rate;
+
+  /// Crossover rate.
+  double crossover_rate;
+
+  /// Evaluation functor.
+  EvaluationFunc evaluation;
+
+  /// Selection functor.
+  SelectionFunc selection;
+
+  /// Crossover functor.
+  CrossoverFunc crossover;
+
+  /// Mutation functor.
+  MutationFunc mutation;
+
+  /// Replacement functor.
+  ReplacementFunc replacement;
+
+  /// Termination functor.
+  TerminationFunc termination;
+
+  /// Run the algorithm until the termination conditions have been met, or
+  /// until the selection functor selects no parents.
+  template <typename T, typename F, typename Rng>
+  void Run(Population<T, F>& pop, Rng& rng) {
+    assert(thread_count > 0);
+    assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
+    assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
+    if (pop.empty()) {
+      return;
+    }
+
+    Evaluate(pop, evaluation, rng);
+
+    std::mutex mutex;
+    std::condition_variable pending_cv, done_cv;
+    std::deque<Individual<T, F>> pending, done;
+    bool stop = false;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&](Rng stream) {
+        for (;;) {
+          Individual<T, F> child;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            pending_cv.wait(lock, [&] { return stop || !pending.empty(); });
+            if (stop) {
+              return;
+            }
+
+            child = std::move(pending.front());
+            pending.pop_front();
+          }
+
+          EvaluateBatch(Span<T>(&child.data, 1), Span<F>(&child.fitness, 1),
+                        evaluation, stream);
+          assert(child.fitness >= 0.0);
+
+          std::lock_guard<std::mutex> lock(mutex);
+          done.push_back(std::move(child));
+          done_cv.notify_one();
+        }
+      }, ForkRng(rng));
+    }
+
+    Population<T, F> parents, brood, offspring;
+    size_t in_flight = 0;
+    bool finished = false;
+    while (!finished) {
+      while (!finished && in_flight < thread_count) {
+        // Without parents nothing is bred until the offspring in flight
+        // change the population.
+        if (brood.empty() && !Breed(pop, parents, brood, rng)) {
+          finished = in_flight == 0;
+          break;
+        }
+
+        Individual<T, F> child = std::move(brood.back());
+        brood.pop_back();
+        if (!child.is_dirty()) {
+          finished = Insert(std::move(child), offspring, pop, rng);
+          continue;
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          pending.push_back(std::move(child));
+        }
+
+        pending_cv.notify_one();
+        ++in_flight;
+      }
+
+      if (finished) {
+        break;
+      }
+
+      Individual<T, F> child;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] { return !done.empty(); });
+        child = std::move(done.front());
+        done.pop_front();
+      }
+
+      --in_flight;
+      finished = Insert(std::move(child), offspring, pop, rng);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+
+    pending_cv.notify_all();
+    for (auto& it : threads) {
+      it.join();
+    }
+  }
+
+ private:
+  // Breed two offspring from the next pair of parents. Returns false if the
+  // selection functor selects no parents.
+  template <typename T, typename F, typename Rng>
+  bool Breed(Population<T, F>& pop, Population<T, F>& parents,
+             Population<T, F>& brood, Rng& rng) {
+    while (parents.size() < 2) {
+      size_t size = parents.size();
+      SelectShuffled(selection, pop, parents, rng);
+      if (parents.size() == size) {
+        return false;
+      }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+      brood.push_back(std::move(parents.back()));
+      parents.pop_back();
+    }
+
+    Individual<T, F>& child0 = brood[brood.size() - 2];
+    Individual<T, F>& child1 = brood[brood.size() - 1];
+
+    std::bernoulli_distribution mutation_dist(mutation_rate);
+    std::bernoulli_distribution crossover_dist(crossover_rate);
+    if (crossover_dist(rng)) {
+      crossover(child0.data, child1.data, rng);
+      child0.mark_dirty();
+      child1.mark_dirty();
+    }
+
+    if (mutation_dist(rng)) {
+      Mutate(mutation, evaluation, child0, rng);
+    }
+
+    if (mutation_dist(rng)) {
+      Mutate(mutation, evaluation, child1, rng);
+    }
+
+    return true;
+  }
+
+  // Insert an evaluated offspring and check the termination conditions.
+  template <typename T, typename F, typename Rng>
+  bool Insert(Individual<T, F>&& child, Population<T, F>& offspring,
+              Population<T, F>& pop, Rng& rng) {
+    offspring.clear();
+    offspring.push_back(std::move(child));
+    replacement(offspring, pop, rng);
+    return termination(pop, rng);
+  }
+};
+
+template <typename... Args>
+AsyncGa<Args...> make_async_ga(size_t thread_count, double mutation_rate,
+                               double crossover_rate, Args... args) {
+  return {thread_count, mutation_rate, crossover_rate, args...};
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_ASYNC_GA_H_
@@ -0,0 +1,261 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_BIT_GENOME_H_
+#define METASINF_INCLUDE_METASINF_BIT_GENOME_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace snf {
+
+/// Dynamically sized bit string, packed into 64-bit words.
+///
+/// Bit `i` is bit `i % 64` of word `i / 64`. The unused bits of the last
+/// word are always zero, so whole words can be compared and counted. The
+/// binary mutation and crossover functors process the genome a word at a
+/// time.
+struct BitGenome {
+  using value_type = bool;
+
+  enum : size_t { kWordBits = 64 };
+
+  /// Proxy to a single bit, as returned by `std::bitset`.
+  struct reference {
+    reference(uint64_t& word, uint64_t mask) : word_(&word), mask_(mask) {}
+
+    operator bool() const { return (*word_ & mask_) != 0; }
+    bool operator~() const { return (*word_ & mask_) == 0; }
+
+    reference& operator=(bool value) {
+      *word_ = value ? *word_ | mask_ : *word_ & ~mask_;
+      return *this;
+    }
+
+    reference& operator=(const reference& other) {
+      return operator=(static_cast<bool>(other));
+    }
+
+    reference& flip() {
+      *word_ ^= mask_;
+      return *this;
+    }
+
+   private:
+    uint64_t* word_;
+    uint64_t mask_;
+  };
+
+  BitGenome() : size_(0) {}
+  explicit BitGenome(size_t size, bool value = false) : size_(0) {
+    resize(size, value);
+  }
+
+  /// Return the number of bits.
+  size_t size() const { return size_; }
+
+  /// Return whether the genome has no bits.
+  bool empty() const { return size_ == 0; }
+
+  /// Return the number of words.
+  size_t word_count() const { return words_.size(); }
+
+  /// Return the words of the genome. Callers that write to them must keep
+  /// the unused bits of the last word zero.
+  uint64_t* words() { return words_.data(); }
+  const uint64_t* words() const { return words_.data(); }
+
+  /// Return a mask of the used bits of the last word.
+  uint64_t tail_mask() const {
+    size_t bits = size_ % kWordBits;
+    return bits == 0 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+  }
+
+  /// Change the number of bits; new bits are set to `value`.
+  void resize(size_t size, bool value = false) {
+    size_t old_size = size_;
+    if (value && old_size % kWordBits != 0 && size > old_size) {
+      words_.back() |= ~tail_mask();
+    }
+
+    size_ = size;
+    words_.resize((size + kWordBits - 1) / kWordBits,
+                  value ? ~uint64_t(0) : 0);
+    if (!words_.empty()) {
+      words_.back() &= tail_mask();
+    }
+  }
+
+  bool operator[](size_t index) const { return test(index); }
+
+  reference operator[](size_t index) {
+    assert(index < size_);
+    return reference(words_[index / kWordBits],
+                     uint64_t(1) << (index % kWordBits));
+  }
+
+  /// Return the bit at `index`.
+  bool test(size_t index) const {
+    assert(index < size_);
+    return (words_[index / kWordBits] >> (index % kWordBits) & 1) != 0;
+  }
+
+  /// Set the bit at `index` to `value`.
+  void set(size_t index, bool value = true) { operator[](index) = value; }
+
+  /// Flip the bit at `index`.
+  void flip(size_t index) {
+    assert(index < size_);
+    words_[index / kWordBits] ^= uint64_t(1) << (index % kWordBits);
+  }
+
+  /// Return the number of set bits.
+  size_t count() const {
+    size_t result = 0;
+    for (uint64_t word : words_) {
+#if defined(__GNUC__)
+      result += __builtin_popcountll(word);
+#else
+      for (; word != 0; word &= word - 1) {
+        ++result;
+      }
+#endif
+    }
+
+    return result;
+  }
+
+  bool operator==(const BitGenome& other) const {
+    return size_ == other.size_ && words_ == other.words_;
+  }
+
+  bool operator!=(const BitGenome& other) const { return !(*this == other); }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(static_cast<uint64_t>(size_));
+    writer.Write(words_);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    uint64_t size = 0;
+    reader.Read(size);
+    reader.Read(words_);
+    size_ = static_cast<size_t>(size);
+    if (words_.size() != (size_ + kWordBits - 1) / kWordBits) {
+      reader.Fail();
+      size_ = 0;
+      words_.clear();
+      return;
+    }
+
+    // Keep the unused bits zero whatever the checkpoint holds.
+    if (!words_.empty()) {
+      words_.back() &= tail_mask();
+    }
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+  size_t size_;
+};
+
+/// Exchange the bits in [`begin`, `end`) between two genomes.
+inline void SwapBits(BitGenome& value0, BitGenome& value1, size_t begin,
+                     size_t end) {
+  assert(begin <= end && end <= std::min(value0.size(), value1.size()));
+  if (begin >= end) {
+    return;
+  }
+
+  enum : size_t { kWordBits = BitGenome::kWordBits };
+
+  uint64_t* words0 = value0.words();
+  uint64_t* words1 = value1.words();
+  size_t first = begin / kWordBits;
+  size_t last = (end - 1) / kWordBits;
+  uint64_t first_mask = ~uint64_t(0) << (begin % kWordBits);
+  uint64_t last_mask =
+      ~uint64_t(0) >> (kWordBits - 1 - (end - 1) % kWordBits);
+  if (first == last) {
+    first_mask &= last_mask;
+  }
+
+  uint64_t diff = (words0[first] ^ words1[first]) & first_mask;
+  words0[first] ^= diff;
+  words1[first] ^= diff;
+  if (first == last) {
+    return;
+  }
+
+  for (size_t i = first + 1; i < last; ++i) {
+    std::swap(words0[i], words1[i]);
+  }
+
+  diff = (words0[last] ^ words1[last]) & last_mask;
+  words0[last] ^= diff;
+  words1[last] ^= diff;
+}
+
+/// Exchange the bits of two genomes that are set in `mask`, which holds one
+/// word for each word of the genomes.
+inline void SwapBits(BitGenome& value0, BitGenome& value1,
+                     const uint64_t* mask) {
+  assert(value0.size() == value1.size());
+  uint64_t* words0 = value0.words();
+  uint64_t* words1 = value1.words();
+  for (size_t i = 0; i < value0.word_count(); ++i) {
+    uint64_t diff = (words0[i] ^ words1[i]) & mask[i];
+    words0[i] ^= diff;
+    words1[i] ^= diff;
+  }
+}
+
+/// Write a bit genome to `dst`, as its size followed by its words.
+inline size_t EncodeGenome(const BitGenome& value, void* dst,
+                           size_t capacity) {
+  uint64_t size = value.size();
+  size_t bytes = sizeof(size) + value.word_count() * sizeof(uint64_t);
+  if (bytes > capacity) {
+    return capacity + 1;
+  }
+
+  std::memcpy(dst, &size, sizeof(size));
+  std::memcpy(static_cast<char*>(dst) + sizeof(size), value.words(),
+              value.word_count() * sizeof(uint64_t));
+  return bytes;
+}
+
+/// Read a bit genome written by `EncodeGenome`. A buffer whose size does
+/// not match the encoded number of bits yields an empty genome.
+inline void DecodeGenome(const void* src, size_t size, BitGenome& value) {
+  enum : size_t { kWordBits = BitGenome::kWordBits };
+
+  uint64_t bits = 0;
+  if (size >= sizeof(bits)) {
+    std::memcpy(&bits, src, sizeof(bits));
+  }
+
+  size_t words = (size - std::min(size, sizeof(bits))) / sizeof(uint64_t);
+  if (size != sizeof(bits) + words * sizeof(uint64_t) ||
+      bits > uint64_t(words) * kWordBits ||
+      bits + kWordBits <= uint64_t(words) * kWordBits) {
+    value.resize(0);
+    return;
+  }
+
+  value.resize(static_cast<size_t>(bits));
+  std::memcpy(value.words(), static_cast<const char*>(src) + sizeof(bits),
+              words * sizeof(uint64_t));
+  if (words > 0) {
+    value.words()[words - 1] &= value.tail_mask();
+  }
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_BIT_GENOME_H_
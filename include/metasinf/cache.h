@@ -0,0 +1,277 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_CACHE_H_
+#define METASINF_INCLUDE_METASINF_CACHE_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "metasinf/population.h"
+
+namespace snf {
+
+/// Hash a contiguous block of memory.
+inline size_t HashBytes(const void* data, size_t size) {
+  static constexpr uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = 0xcbf29ce484222325ULL ^ (size * kMul);
+  for (; size >= 8; bytes += 8, size -= 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes, 8);
+    hash = (hash ^ word) * kMul;
+    hash ^= hash >> 32;
+  }
+
+  uint64_t tail = 0;
+  std::memcpy(&tail, bytes, size);
+  hash = (hash ^ tail) * kMul;
+  hash ^= hash >> 29;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 32;
+  return static_cast<size_t>(hash);
+}
+
+/// Default genome hash.
+///
+/// Trivially copyable genomes and contiguous containers of trivially copyable
+/// elements are hashed by their bytes. Every other genome falls back to
+/// `std::hash`.
+struct GenomeHash {
+  template <typename T>
+  size_t operator()(const T& value) const {
+    return Hash(value, 0);
+  }
+
+ private:
+  template <typename T>
+  static typename std::enable_if<std::is_trivially_copyable<T>::value,
+                                 size_t>::type
+  Hash(const T& value, int) {
+    return HashBytes(&value, sizeof(T));
+  }
+
+  template <typename T>
+  static typename std::enable_if<
+      !std::is_trivially_copyable<T>::value &&
+          std::is_trivially_copyable<typename T::value_type>::value &&
+          std::is_pointer<decltype(std::declval<const T&>().data())>::value,
+      size_t>::type
+  Hash(const T& value, int) {
+    return HashBytes(value.data(), value.size() * sizeof(*value.data()));
+  }
+
+  template <typename T>
+  static size_t Hash(const T& value, long) {
+    return std::hash<T>()(value);
+  }
+};
+
+/// Cache the fitness of previously evaluated genomes.
+///
+/// Genomes are looked up by their hash and compared for equality, so hash
+/// collisions never return a wrong fitness. The cache holds at most
+/// `capacity` genomes and evicts entries using the CLOCK policy. The wrapped
+/// evaluation functor must be deterministic.
+///
+/// The cache is a batch evaluator: duplicate genomes within a batch are
+/// evaluated once and only the cache misses are dispatched to the wrapped
+/// functor, as a single batch.
+///
+/// The cache is not synchronised and must only be used by one thread at a
+/// time. To evaluate in parallel, wrap an `EvaluationParallel` in the cache,
+/// so that the misses are spread over the workers; never wrap the cache in
+/// an `EvaluationParallel`, or use it from `AsyncGa`, which evaluate on
+/// several threads at once.
+template <typename T, typename F, typename EvaluationFunc,
+          typename Hash = GenomeHash>
+struct EvaluationCache {
+  explicit EvaluationCache(size_t capacity,
+                           const EvaluationFunc& func = EvaluationFunc(),
+                           const Hash& hash = Hash())
+      : func(func),
+        hash(hash),
+        capacity_(capacity),
+        hand_(0),
+        hits_(0),
+        misses_(0) {
+    assert(capacity > 0);
+  }
+
+  /// Wrapped evaluation functor.
+  EvaluationFunc func;
+
+  /// Genome hash functor.
+  Hash hash;
+
+  /// Return the maximum number of cached genomes.
+  size_t capacity() const { return capacity_; }
+
+  /// Return the number of cached genomes.
+  size_t size() const { return index_.size(); }
+
+  /// Return the number of lookups that found a cached fitness.
+  uint64_t hits() const { return hits_; }
+
+  /// Return the number of lookups that required an evaluation.
+  uint64_t misses() const { return misses_; }
+
+  /// Remove all cached genomes and reset the counters.
+  void clear() {
+    entries_.clear();
+    index_.clear();
+    hand_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+  /// Look up the fitness of the specified genome.
+  bool Find(const T& data, size_t key, F& fitness) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+
+    Entry& entry = entries_[it->second];
+    if (!(entry.data == data)) {
+      return false;
+    }
+
+    entry.referenced = true;
+    fitness = entry.fitness;
+    return true;
+  }
+
+  /// Store the fitness of the specified genome.
+  void Insert(T data, size_t key, F fitness) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      Entry& entry = entries_[it->second];
+      entry.data = std::move(data);
+      entry.fitness = fitness;
+      entry.referenced = true;
+      return;
+    }
+
+    size_t slot;
+    if (entries_.size() < capacity_) {
+      slot = entries_.size();
+      entries_.push_back(Entry());
+    } else {
+      while (entries_[hand_].referenced) {
+        entries_[hand_].referenced = false;
+        hand_ = (hand_ + 1) % capacity_;
+      }
+
+      slot = hand_;
+      hand_ = (hand_ + 1) % capacity_;
+      index_.erase(entries_[slot].key);
+    }
+
+    Entry& entry = entries_[slot];
+    entry.data = std::move(data);
+    entry.key = key;
+    entry.fitness = fitness;
+    entry.referenced = false;
+    index_[key] = slot;
+  }
+
+  template <typename Rng>
+  F operator()(T& data, Rng& rng) {
+    size_t key = hash(data);
+    F fitness;
+    if (Find(data, key, fitness)) {
+      ++hits_;
+      return fitness;
+    }
+
+    ++misses_;
+    fitness = func(data, rng);
+    Insert(data, key, fitness);
+    return fitness;
+  }
+
+  template <typename Rng>
+  void operator()(Span<T> data, Span<F> fitness, Rng& rng) {
+    std::vector<T> batch;
+    std::vector<F> batch_fitness;
+    std::vector<size_t> keys;
+    std::vector<std::pair<size_t, size_t>> targets;
+    std::unordered_multimap<size_t, size_t> pending;
+
+    for (size_t i = 0; i < data.size(); ++i) {
+      size_t key = hash(data[i]);
+      if (Find(data[i], key, fitness[i])) {
+        ++hits_;
+        continue;
+      }
+
+      size_t index = batch.size();
+      auto range = pending.equal_range(key);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (batch[it->second] == data[i]) {
+          index = it->second;
+          break;
+        }
+      }
+
+      if (index == batch.size()) {
+        ++misses_;
+        pending.emplace(key, index);
+        keys.push_back(key);
+        batch.push_back(data[i]);
+      } else {
+        ++hits_;
+      }
+
+      targets.emplace_back(i, index);
+    }
+
+    if (batch.empty()) {
+      return;
+    }
+
+    batch_fitness.assign(batch.size(), -1.0);
+    EvaluateBatch(Span<T>(batch.data(), batch.size()),
+                  Span<F>(batch_fitness.data(), batch_fitness.size()), func,
+                  rng);
+    for (const auto& it : targets) {
+      fitness[it.first] = batch_fitness[it.second];
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      Insert(std::move(batch[i]), keys[i], batch_fitness[i]);
+    }
+  }
+
+ private:
+  struct Entry {
+    T data;
+    size_t key;
+    F fitness;
+    bool referenced;
+  };
+
+  std::vector<Entry> entries_;
+  std::unordered_map<size_t, size_t> index_;
+  size_t capacity_;
+  size_t hand_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+template <typename T, typename F, typename EvaluationFunc>
+EvaluationCache<T, F, EvaluationFunc> make_evaluation_cache(
+    size_t capacity, EvaluationFunc func) {
+  return EvaluationCache<T, F, EvaluationFunc>(capacity, func);
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_CACHE_H_
@@ -0,0 +1,689 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_CHECKPOINT_H_
+#define METASINF_INCLUDE_METASINF_CHECKPOINT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/population.h"
+#include "metasinf/population_matrix.h"
+
+namespace snf {
+
+/// Binary checkpoint format.
+///
+/// A checkpoint starts with a header holding a magic string, the version of
+/// the format, a byte order mark and a version chosen by the application for
+/// the layout of its values. The values follow in the order in which they
+/// were saved, and the checkpoint ends with the number of bytes written
+/// before it, which detects truncated files. Values are stored in the byte
+/// order of the host, so checkpoints can only be restored on platforms with
+/// the same data model.
+struct CheckpointFormat {
+  enum : uint32_t { kVersion = 1, kByteOrder = 0x01020304 };
+
+  enum : size_t { kMagicSize = 8 };
+
+  /// Return the magic string, including its terminating null character.
+  static const char* magic() { return "SNFCKPT"; }
+};
+
+/// Binary writer of checkpoint values.
+///
+/// Values are written with `Write`, which calls `Save(writer, value)`. The
+/// overloads provided by the library write trivially copyable types as
+/// bytes, containers element by element, and call `value.Save(writer)` on
+/// types that provide it. Other types are supported by declaring a `Save`
+/// overload in their namespace.
+struct CheckpointWriter {
+  /// Write to a stream.
+  explicit CheckpointWriter(std::ostream& out)
+      : out_(&out), buffer_(nullptr), size_(0) {}
+
+  /// Append to a buffer.
+  explicit CheckpointWriter(std::string& buffer)
+      : out_(nullptr), buffer_(&buffer), size_(0) {}
+
+  /// Return whether every write has succeeded.
+  bool good() const { return buffer_ != nullptr || out_->good(); }
+
+  /// Return the number of bytes written.
+  uint64_t size() const { return size_; }
+
+  void WriteBytes(const void* data, size_t size) {
+    if (buffer_ != nullptr) {
+      buffer_->append(static_cast<const char*>(data), size);
+    } else {
+      out_->write(static_cast<const char*>(data), size);
+    }
+
+    size_ += size;
+  }
+
+  template <typename T>
+  void Write(const T& value) {
+    Save(*this, value);
+  }
+
+ private:
+  std::ostream* out_;
+  std::string* buffer_;
+  uint64_t size_;
+};
+
+/// Binary reader of checkpoint values.
+///
+/// Values are read with `Read`, which calls `Load(reader, value)`; see
+/// `CheckpointWriter`.
+struct CheckpointReader {
+  /// Read from a stream. If the stream is seekable, the size fields of the
+  /// checkpoint are checked against the number of bytes left in it.
+  explicit CheckpointReader(std::istream& in)
+      : in_(&in), size_(0), limit_(std::numeric_limits<uint64_t>::max()) {
+    std::istream::pos_type start = in.tellg();
+    if (start != std::istream::pos_type(-1) && in.seekg(0, std::ios::end)) {
+      std::istream::pos_type end = in.tellg();
+      if (end != std::istream::pos_type(-1) && end >= start) {
+        limit_ = static_cast<uint64_t>(end - start);
+      }
+    }
+
+    in.clear(in.rdstate() & ~std::ios::failbit);
+    if (start != std::istream::pos_type(-1)) {
+      in.seekg(start);
+    }
+  }
+
+  /// Return whether every read has succeeded.
+  bool good() const { return in_->good(); }
+
+  /// Return the number of bytes read.
+  uint64_t size() const { return size_; }
+
+  /// Check that `count` values of at least `value_size` bytes each can still
+  /// be read, before allocating room for them. Marks the checkpoint as
+  /// invalid and returns false otherwise.
+  bool CheckSize(uint64_t count, uint64_t value_size) {
+    uint64_t left = limit_ > size_ ? limit_ - size_ : 0;
+    if (!good() || (value_size > 0 && count > left / value_size)) {
+      Fail();
+      return false;
+    }
+
+    return true;
+  }
+
+  void ReadBytes(void* data, size_t size) {
+    in_->read(static_cast<char*>(data), size);
+    size_ += size;
+  }
+
+  /// Mark the checkpoint as invalid.
+  void Fail() { in_->setstate(std::ios::failbit); }
+
+  template <typename T>
+  bool Read(T& value) {
+    Load(*this, value);
+    return good();
+  }
+
+ private:
+  std::istream* in_;
+  uint64_t size_;
+  uint64_t limit_;
+};
+
+/// Check whether a type saves and loads its own checkpoint state through
+/// `value.Save(writer)` and `value.Load(reader)`.
+template <typename T>
+struct HasCheckpointMembers {
+  template <typename U>
+  static auto Test(U* value) -> decltype(
+      static_cast<const U*>(value)->Save(std::declval<CheckpointWriter&>()),
+      value->Load(std::declval<CheckpointReader&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value = decltype(Test(static_cast<T*>(nullptr)))::value;
+};
+
+/// Check whether a type is checkpointed as its object representation.
+template <typename T>
+struct IsCheckpointBytes {
+  static constexpr bool value =
+      std::is_trivially_copyable<T>::value && !HasCheckpointMembers<T>::value;
+};
+
+template <typename T>
+typename std::enable_if<IsCheckpointBytes<T>::value>::type Save(
+    CheckpointWriter& writer, const T& value) {
+  writer.WriteBytes(&value, sizeof(T));
+}
+
+template <typename T>
+typename std::enable_if<IsCheckpointBytes<T>::value>::type Load(
+    CheckpointReader& reader, T& value) {
+  reader.ReadBytes(&value, sizeof(T));
+}
+
+template <typename T>
+typename std::enable_if<HasCheckpointMembers<T>::value>::type Save(
+    CheckpointWriter& writer, const T& value) {
+  value.Save(writer);
+}
+
+template <typename T>
+typename std::enable_if<HasCheckpointMembers<T>::value>::type Load(
+    CheckpointReader& reader, T& value) {
+  value.Load(reader);
+}
+
+// Vectors of trivially copyable elements are written as a single block.
+template <typename T, typename Alloc>
+void SaveElements(CheckpointWriter& writer,
+                  const std::vector<T, Alloc>& value, std::true_type) {
+  writer.WriteBytes(value.data(), value.size() * sizeof(T));
+}
+
+template <typename T, typename Alloc>
+void SaveElements(CheckpointWriter& writer,
+                  const std::vector<T, Alloc>& value, std::false_type) {
+  for (const auto& it : value) {
+    writer.Write(it);
+  }
+}
+
+template <typename T, typename Alloc>
+void LoadElements(CheckpointReader& reader, std::vector<T, Alloc>& value,
+                  std::true_type) {
+  reader.ReadBytes(value.data(), value.size() * sizeof(T));
+}
+
+template <typename T, typename Alloc>
+void LoadElements(CheckpointReader& reader, std::vector<T, Alloc>& value,
+                  std::false_type) {
+  for (auto& it : value) {
+    if (!reader.Read(it)) {
+      return;
+    }
+  }
+}
+
+template <typename T, typename Alloc>
+void Save(CheckpointWriter& writer, const std::vector<T, Alloc>& value) {
+  writer.Write(static_cast<uint64_t>(value.size()));
+  SaveElements(writer, value,
+               std::integral_constant<bool, IsCheckpointBytes<T>::value>());
+}
+
+// Resize a vector before loading into it. Elements that cannot be
+// default-constructed are copied from the first element.
+template <typename T, typename Alloc>
+bool ResizeForLoad(std::vector<T, Alloc>& value, size_t size,
+                   std::true_type) {
+  value.resize(size);
+  return true;
+}
+
+template <typename T, typename Alloc>
+bool ResizeForLoad(std::vector<T, Alloc>& value, size_t size,
+                   std::false_type) {
+  if (value.empty()) {
+    return size == 0;
+  }
+
+  value.resize(size, value.front());
+  return true;
+}
+
+/// Load a vector. Vectors of elements that cannot be default-constructed,
+/// such as islands, must not be empty. Every element is assumed to take at
+/// least one byte, which holds for the values written by the library.
+template <typename T, typename Alloc>
+void Load(CheckpointReader& reader, std::vector<T, Alloc>& value) {
+  using IsBytes = std::integral_constant<bool, IsCheckpointBytes<T>::value>;
+
+  uint64_t size = 0;
+  if (!reader.Read(size) ||
+      !reader.CheckSize(size, IsBytes::value ? sizeof(T) : 1)) {
+    return;
+  }
+
+  if (!ResizeForLoad(value, size, std::is_default_constructible<T>())) {
+    reader.Fail();
+    return;
+  }
+
+  LoadElements(reader, value, IsBytes());
+}
+
+// Bit vectors have no contiguous storage; their elements are written as
+// one byte each.
+template <typename Alloc>
+void Save(CheckpointWriter& writer, const std::vector<bool, Alloc>& value) {
+  writer.Write(static_cast<uint64_t>(value.size()));
+  for (bool it : value) {
+    writer.Write(static_cast<uint8_t>(it));
+  }
+}
+
+template <typename Alloc>
+void Load(CheckpointReader& reader, std::vector<bool, Alloc>& value) {
+  uint64_t size = 0;
+  if (!reader.Read(size) || !reader.CheckSize(size, 1)) {
+    return;
+  }
+
+  value.resize(size);
+  for (size_t i = 0; i < value.size(); ++i) {
+    uint8_t bit = 0;
+    if (!reader.Read(bit)) {
+      return;
+    }
+
+    value[i] = bit != 0;
+  }
+}
+
+template <typename CharT, typename Traits, typename Alloc>
+void Save(CheckpointWriter& writer,
+          const std::basic_string<CharT, Traits, Alloc>& value) {
+  writer.Write(static_cast<uint64_t>(value.size()));
+  writer.WriteBytes(value.data(), value.size() * sizeof(CharT));
+}
+
+template <typename CharT, typename Traits, typename Alloc>
+void Load(CheckpointReader& reader,
+          std::basic_string<CharT, Traits, Alloc>& value) {
+  uint64_t size = 0;
+  if (reader.Read(size) && reader.CheckSize(size, sizeof(CharT))) {
+    value.resize(size);
+    reader.ReadBytes(&value[0], size * sizeof(CharT));
+  }
+}
+
+template <typename T, typename F>
+void Save(CheckpointWriter& writer, const Individual<T, F>& value) {
+  writer.Write(value.data);
+  writer.Write(value.fitness);
+}
+
+template <typename T, typename F>
+void Load(CheckpointReader& reader, Individual<T, F>& value) {
+  reader.Read(value.data);
+  reader.Read(value.fitness);
+}
+
+template <typename E, typename F>
+void Save(CheckpointWriter& writer, const PopulationMatrix<E, F>& value) {
+  static_assert(std::is_trivially_copyable<E>::value,
+                "The genome elements must be trivially copyable");
+
+  writer.Write(static_cast<uint64_t>(value.size()));
+  writer.Write(static_cast<uint64_t>(value.length()));
+  for (size_t i = 0; i < value.size(); ++i) {
+    writer.WriteBytes(value.row(i).data(), value.length() * sizeof(E));
+  }
+
+  writer.WriteBytes(value.fitness(), value.size() * sizeof(F));
+  writer.WriteBytes(value.dirty(), value.size());
+}
+
+template <typename E, typename F>
+void Load(CheckpointReader& reader, PopulationMatrix<E, F>& value) {
+  uint64_t size = 0;
+  uint64_t length = 0;
+  if (!reader.Read(size) || !reader.Read(length) ||
+      !reader.CheckSize(length, sizeof(E)) ||
+      !reader.CheckSize(size, length * sizeof(E) + sizeof(F) + 1)) {
+    return;
+  }
+
+  value.clear();
+  value.set_length(length);
+  value.resize(size);
+  for (size_t i = 0; i < value.size(); ++i) {
+    reader.ReadBytes(value.row(i).data(), value.length() * sizeof(E));
+  }
+
+  std::vector<uint8_t> dirty(size);
+  reader.ReadBytes(value.fitness(), value.size() * sizeof(F));
+  reader.ReadBytes(dirty.data(), dirty.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (dirty[i]) {
+      value[i].mark_dirty();
+    } else {
+      value.set_fitness(i, value.fitness()[i]);
+    }
+  }
+}
+
+// The standard engines are saved through their textual representation,
+// which the standard specifies.
+template <typename Engine>
+void SaveEngine(CheckpointWriter& writer, const Engine& value) {
+  std::ostringstream out;
+  out << value;
+  writer.Write(out.str());
+}
+
+template <typename Engine>
+void LoadEngine(CheckpointReader& reader, Engine& value) {
+  std::string state;
+  if (reader.Read(state)) {
+    std::istringstream in(state);
+    in >> value;
+  }
+}
+
+template <typename UIntType, size_t w, size_t n, size_t m, size_t r,
+          UIntType a, size_t u, UIntType d, size_t s, UIntType b, size_t t,
+          UIntType c, size_t l, UIntType f>
+void Save(CheckpointWriter& writer,
+          const std::mersenne_twister_engine<UIntType, w, n, m, r, a, u, d, s,
+                                             b, t, c, l, f>& value) {
+  SaveEngine(writer, value);
+}
+
+template <typename UIntType, size_t w, size_t n, size_t m, size_t r,
+          UIntType a, size_t u, UIntType d, size_t s, UIntType b, size_t t,
+          UIntType c, size_t l, UIntType f>
+void Load(CheckpointReader& reader,
+          std::mersenne_twister_engine<UIntType, w, n, m, r, a, u, d, s, b, t,
+                                       c, l, f>& value) {
+  LoadEngine(reader, value);
+}
+
+template <typename UIntType, UIntType a, UIntType c, UIntType m>
+void Save(CheckpointWriter& writer,
+          const std::linear_congruential_engine<UIntType, a, c, m>& value) {
+  SaveEngine(writer, value);
+}
+
+template <typename UIntType, UIntType a, UIntType c, UIntType m>
+void Load(CheckpointReader& reader,
+          std::linear_congruential_engine<UIntType, a, c, m>& value) {
+  LoadEngine(reader, value);
+}
+
+template <typename UIntType, size_t w, size_t s, size_t r>
+void Save(CheckpointWriter& writer,
+          const std::subtract_with_carry_engine<UIntType, w, s, r>& value) {
+  SaveEngine(writer, value);
+}
+
+template <typename UIntType, size_t w, size_t s, size_t r>
+void Load(CheckpointReader& reader,
+          std::subtract_with_carry_engine<UIntType, w, s, r>& value) {
+  LoadEngine(reader, value);
+}
+
+inline void SaveValues(CheckpointWriter& writer) {}
+
+template <typename T, typename... Args>
+void SaveValues(CheckpointWriter& writer, const T& value,
+                const Args&... values) {
+  writer.Write(value);
+  SaveValues(writer, values...);
+}
+
+inline void LoadValues(CheckpointReader& reader) {}
+
+template <typename T, typename... Args>
+void LoadValues(CheckpointReader& reader, T& value, Args&... values) {
+  if (reader.Read(value)) {
+    LoadValues(reader, values...);
+  }
+}
+
+/// Write a checkpoint of the specified values.
+///
+/// `version` identifies the layout of the values and must be passed again
+/// when the checkpoint is loaded. Returns whether the checkpoint has been
+/// written.
+template <typename... Args>
+bool SaveCheckpoint(CheckpointWriter& writer, uint32_t version,
+                    const Args&... values) {
+  writer.WriteBytes(CheckpointFormat::magic(), CheckpointFormat::kMagicSize);
+  writer.Write(static_cast<uint32_t>(CheckpointFormat::kVersion));
+  writer.Write(static_cast<uint32_t>(CheckpointFormat::kByteOrder));
+  writer.Write(version);
+  SaveValues(writer, values...);
+  writer.Write(writer.size());
+  return writer.good();
+}
+
+template <typename... Args>
+bool SaveCheckpoint(std::ostream& out, uint32_t version,
+                    const Args&... values) {
+  CheckpointWriter writer(out);
+  return SaveCheckpoint(writer, version, values...) && out.flush().good();
+}
+
+/// Restore the values of a checkpoint.
+///
+/// Returns whether the checkpoint is valid, its versions match and all the
+/// values have been restored. On failure the values are left in an
+/// unspecified state.
+template <typename... Args>
+bool LoadCheckpoint(CheckpointReader& reader, uint32_t version,
+                    Args&... values) {
+  char magic[CheckpointFormat::kMagicSize];
+  uint32_t format_version = 0;
+  uint32_t byte_order = 0;
+  uint32_t value_version = 0;
+  reader.ReadBytes(magic, sizeof(magic));
+  if (!reader.Read(format_version) || !reader.Read(byte_order) ||
+      !reader.Read(value_version)) {
+    return false;
+  }
+
+  if (std::memcmp(magic, CheckpointFormat::magic(), sizeof(magic)) != 0 ||
+      format_version != CheckpointFormat::kVersion ||
+      byte_order != CheckpointFormat::kByteOrder || value_version != version) {
+    return false;
+  }
+
+  LoadValues(reader, values...);
+  uint64_t expected_size = reader.size();
+  uint64_t size = 0;
+  return reader.Read(size) && size == expected_size;
+}
+
+template <typename... Args>
+bool LoadCheckpoint(std::istream& in, uint32_t version, Args&... values) {
+  CheckpointReader reader(in);
+  return LoadCheckpoint(reader, version, values...);
+}
+
+// Write a buffer to a temporary file and rename it over the destination,
+// so that an interrupted write never replaces a valid checkpoint.
+inline bool WriteCheckpointFile(const std::string& path,
+                                const std::string& data) {
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.write(data.data(), data.size()).flush()) {
+      return false;
+    }
+  }
+
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+/// Write a checkpoint of the specified values to a file, replacing it
+/// atomically.
+template <typename... Args>
+bool SaveCheckpointFile(const std::string& path, uint32_t version,
+                        const Args&... values) {
+  std::string data;
+  CheckpointWriter writer(data);
+  return SaveCheckpoint(writer, version, values...) &&
+         WriteCheckpointFile(path, data);
+}
+
+/// Restore the values of a checkpoint file.
+template <typename... Args>
+bool LoadCheckpointFile(const std::string& path, uint32_t version,
+                        Args&... values) {
+  std::ifstream in(path, std::ios::binary);
+  return in && LoadCheckpoint(in, version, values...);
+}
+
+/// Periodic checkpointing to a file on a background thread.
+///
+/// Every `period` calls, the values are serialized into a memory buffer on
+/// the calling thread and the buffer is handed to a background thread, which
+/// writes it to the file. The generation loop thus only waits for the
+/// in-memory copy. If a snapshot is taken while the previous one is still
+/// being written, the older pending snapshot is dropped in favor of the
+/// newer one. The destructor waits until the last snapshot has been written.
+///
+///     snf::AsyncCheckpoint checkpoint("run.ckpt", 100, kVersion);
+///     while (!ga(pop, rng)) {
+///       checkpoint(pop, rng, ga);
+///     }
+struct AsyncCheckpoint {
+  AsyncCheckpoint(const std::string& path, size_t period, uint32_t version)
+      : path(path),
+        period(period),
+        version(version),
+        count_(0),
+        written_(0),
+        failed_(0),
+        has_pending_(false),
+        writing_(false),
+        stop_(false) {
+    thread_ = std::thread(&AsyncCheckpoint::Work, this);
+  }
+
+  AsyncCheckpoint(const AsyncCheckpoint&) = delete;
+  AsyncCheckpoint& operator=(const AsyncCheckpoint&) = delete;
+
+  ~AsyncCheckpoint() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  /// Checkpoint file.
+  const std::string path;
+
+  /// Number of calls between two snapshots.
+  size_t period;
+
+  /// Version of the layout of the values.
+  uint32_t version;
+
+  /// Count a call and take a snapshot of the values every `period` calls.
+  /// Returns whether a snapshot has been taken.
+  template <typename... Args>
+  bool operator()(const Args&... values) {
+    if (period == 0 || ++count_ % period != 0) {
+      return false;
+    }
+
+    Snapshot(values...);
+    return true;
+  }
+
+  /// Take a snapshot of the values.
+  template <typename... Args>
+  void Snapshot(const Args&... values) {
+    buffer_.clear();
+    CheckpointWriter writer(buffer_);
+    SaveCheckpoint(writer, version, values...);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.swap(buffer_);
+      has_pending_ = true;
+    }
+
+    cv_.notify_all();
+  }
+
+  /// Wait until every snapshot has been written.
+  void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !has_pending_ && !writing_; });
+  }
+
+  /// Return the number of snapshots written to the file.
+  size_t written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+  }
+
+  /// Return the number of snapshots that could not be written.
+  size_t failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+  }
+
+ private:
+  void Work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return has_pending_ || stop_; });
+      if (!has_pending_) {
+        return;
+      }
+
+      data_.swap(pending_);
+      has_pending_ = false;
+      writing_ = true;
+      lock.unlock();
+
+      bool result = WriteCheckpointFile(path, data_);
+
+      lock.lock();
+      writing_ = false;
+      if (result) {
+        ++written_;
+      } else {
+        ++failed_;
+      }
+
+      cv_.notify_all();
+    }
+  }
+
+  size_t count_;
+  size_t written_;
+  size_t failed_;
+  std::string buffer_;
+  std::string pending_;
+  std::string data_;
+  bool has_pending_;
+  bool writing_;
+  bool stop_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_CHECKPOINT_H_
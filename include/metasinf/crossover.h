@@ -4,9 +4,15 @@
 #ifndef METASINF_INCLUDE_METASINF_CROSSOVER_H_
 #define METASINF_INCLUDE_METASINF_CROSSOVER_H_
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cstdint>
 #include <random>
+#include <vector>
+
+#include "metasinf/bit_genome.h"
+#include "metasinf/random.h"
 
 namespace snf {
 
@@ -30,6 +36,27 @@ struct CrossoverPoint {
       std::swap_ranges(value0.begin(), value0.begin() + index, value1.begin());
     }
   }
+
+  /// Every point swaps the prefix before it, so a bit is exchanged when an
+  /// odd number of points lie after it. The segments between the sorted
+  /// points are swapped a word at a time.
+  template <typename Rng>
+  void operator()(BitGenome& value0, BitGenome& value1, Rng& rng) {
+    thread_local std::vector<size_t> points;
+
+    assert(value0.size() == value1.size());
+    std::uniform_int_distribution<size_t> dist(0, value0.size() - 1);
+    points.resize(point_count);
+    for (auto& it : points) {
+      it = dist(rng);
+    }
+
+    std::sort(points.begin(), points.end());
+    for (size_t i = points.size(); i > 0; i -= std::min<size_t>(i, 2)) {
+      size_t begin = i > 1 ? points[i - 2] : 0;
+      SwapBits(value0, value1, begin, points[i - 1]);
+    }
+  }
 };
 
 /// Uniform crossover.
@@ -47,6 +74,16 @@ struct CrossoverUniform {
       }
     }
   }
+
+  /// Bit genomes exchange the bits set in a random mask.
+  template <typename Rng>
+  void operator()(BitGenome& value0, BitGenome& value1, Rng& rng) {
+    thread_local std::vector<uint64_t> mask;
+
+    mask.resize(value0.word_count());
+    SampleBernoulliWords(0.5, mask.data(), mask.size(), rng);
+    SwapBits(value0, value1, mask.data());
+  }
 };
 
 /// Partially-matched crossover.
@@ -148,6 +185,30 @@ struct CrossoverSbx {
   }
 };
 
+/// Apply a crossover algorithm to each pair of elements of two vectors.
+template <typename CrossoverFunc>
+struct CrossoverVector {
+  CrossoverVector(double prob, const CrossoverFunc& func = CrossoverFunc())
+      : prob(prob), func(func) {}
+
+  /// Crossover probability of each pair of elements.
+  double prob;
+
+  /// Wrapped crossover algorithm.
+  CrossoverFunc func;
+
+  template <typename T, typename Rng>
+  void operator()(T& value0, T& value1, Rng& rng) {
+    assert(value0.size() == value1.size());
+    std::bernoulli_distribution dist(prob);
+    for (size_t i = 0; i < value0.size(); ++i) {
+      if (dist(rng)) {
+        func(value0[i], value1[i], rng);
+      }
+    }
+  }
+};
+
 }  // namespace snf
 
 #endif  // METASINF_INCLUDE_METASINF_CROSSOVER_H_
@@ -0,0 +1,156 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_DELTA_H_
+#define METASINF_INCLUDE_METASINF_DELTA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snf {
+
+/// Record of the positions changed by a mutation.
+///
+/// Every changed position is listed once, together with the value it held
+/// before the mutation, in the order in which it was first changed.
+template <typename E>
+struct MutationLog {
+  using Entry = std::pair<size_t, E>;
+
+  /// Record that the element at `index` is about to change from `value`.
+  /// Later changes to the same position are ignored.
+  void Record(size_t index, const E& value) {
+    if (index >= seen_.size()) {
+      seen_.resize(index + 1, 0);
+    }
+
+    if (!seen_[index]) {
+      seen_[index] = 1;
+      entries_.emplace_back(index, value);
+    }
+  }
+
+  /// Return the number of changed positions.
+  size_t size() const { return entries_.size(); }
+
+  /// Return whether no position has changed.
+  bool empty() const { return entries_.empty(); }
+
+  const Entry& operator[](size_t index) const { return entries_[index]; }
+
+  typename std::vector<Entry>::const_iterator begin() const {
+    return entries_.begin();
+  }
+
+  typename std::vector<Entry>::const_iterator end() const {
+    return entries_.end();
+  }
+
+  void clear() {
+    for (const auto& it : entries_) {
+      seen_[it.first] = 0;
+    }
+
+    entries_.clear();
+  }
+
+ private:
+  std::vector<Entry> entries_;
+  std::vector<uint8_t> seen_;
+};
+
+/// Mutation log that discards every record.
+struct MutationLogNone {
+  template <typename E>
+  void Record(size_t index, const E& value) {}
+};
+
+/// Check whether a mutation functor can record the positions it changes.
+///
+/// Logging mutations provide `func(value, log, rng)`, which records every
+/// change in `log` before performing it.
+template <typename MutationFunc, typename T, typename Rng>
+struct HasMutationLog {
+  template <typename U, typename V = T>
+  static auto Test(U* func) -> decltype(
+      (*func)(std::declval<V&>(),
+              std::declval<MutationLog<typename V::value_type>&>(),
+              std::declval<Rng&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<MutationFunc*>(nullptr)))::value;
+};
+
+/// Check whether an evaluation functor can update a fitness incrementally.
+///
+/// Delta evaluators provide `func.Delta(value, fitness, log, rng)`, which
+/// receives the mutated genome, the fitness before the mutation and the log
+/// of changes, and returns the fitness of the mutated genome.
+template <typename EvaluationFunc, typename T, typename F, typename Rng>
+struct IsDeltaEvaluator {
+  template <typename U, typename V = T>
+  static auto Test(U* func) -> decltype(
+      func->Delta(std::declval<V&>(), std::declval<F>(),
+                  std::declval<const MutationLog<typename V::value_type>&>(),
+                  std::declval<Rng&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<EvaluationFunc*>(nullptr)))::value;
+};
+
+template <typename MutationFunc, typename EvaluationFunc, typename Ind,
+          typename Rng>
+void Mutate(MutationFunc& mutation, EvaluationFunc& evaluation, Ind& child,
+            Rng& rng, std::true_type) {
+  using T = typename std::decay<decltype(child.data)>::type;
+  thread_local MutationLog<typename T::value_type> log;
+
+  if (child.is_dirty()) {
+    mutation(child.data, rng);
+    return;
+  }
+
+  log.clear();
+  mutation(child.data, log, rng);
+  child.fitness = evaluation.Delta(child.data, child.fitness, log, rng);
+  assert(child.fitness >= 0.0);
+}
+
+template <typename MutationFunc, typename EvaluationFunc, typename Ind,
+          typename Rng>
+void Mutate(MutationFunc& mutation, EvaluationFunc& evaluation, Ind& child,
+            Rng& rng, std::false_type) {
+  mutation(child.data, rng);
+  child.mark_dirty();
+}
+
+/// Mutate an individual.
+///
+/// If the individual has a valid fitness, the mutation records its changes
+/// and the evaluator supports delta evaluation, the fitness is updated
+/// incrementally. Otherwise the individual is marked dirty.
+template <typename MutationFunc, typename EvaluationFunc, typename Ind,
+          typename Rng>
+void Mutate(MutationFunc& mutation, EvaluationFunc& evaluation, Ind&& child,
+            Rng& rng) {
+  using T = typename std::decay<decltype(child.data)>::type;
+  using F = typename std::decay<decltype(child.fitness)>::type;
+  Mutate(mutation, evaluation, child, rng,
+         std::integral_constant<bool,
+             HasMutationLog<MutationFunc, T, Rng>::value &&
+             IsDeltaEvaluator<EvaluationFunc, T, F, Rng>::value>());
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_DELTA_H_
@@ -4,6 +4,7 @@
 #ifndef METASINF_INCLUDE_METASINF_EDA_H_
 #define METASINF_INCLUDE_METASINF_EDA_H_
 
+#include "metasinf/metrics.h"
 #include "metasinf/population.h"
 #include "metasinf/termination.h"
 
@@ -14,17 +15,20 @@ namespace snf {
 template <
     typename EvaluationFunc,
     typename UpdateFunc,
-    typename TerminationFunc>
+    typename TerminationFunc,
+    typename ObserverFunc = ObserverNone>
 struct Eda {
   /// Construct a new simulation.
   Eda(size_t pop_size,
       const EvaluationFunc& evaluation = EvaluationFunc(),
       const UpdateFunc& update = UpdateFunc(),
-      const TerminationFunc& termination = TerminationFunc())
+      const TerminationFunc& termination = TerminationFunc(),
+      const ObserverFunc& observer = ObserverFunc())
       : pop_size(pop_size),
         evaluation(evaluation),
         update(update),
-        termination(termination) {}
+        termination(termination),
+        observer(observer) {}
 
   /// Population size.
   size_t pop_size;
@@ -38,20 +42,40 @@ struct Eda {
   /// Termination functor.
   TerminationFunc termination;
 
+  /// Observer, which is notified of the phases and the evaluations of every
+  /// step. The default observer does nothing.
+  ObserverFunc observer;
+
   /// Perform the next evolution step.
   template <typename T, typename F, typename DistFunc, typename Rng>
   bool operator()(DistFunc& dist, Rng& rng) {
     thread_local Population<T, F> pop;
 
+    observer.Begin(MetricsPhase::kSample);
     pop.clear();
     pop.resize(pop_size);
     for (auto& it : pop) {
       dist(it.data, rng);
     }
 
-    Evaluate(pop, evaluation, rng);
+    observer.End(MetricsPhase::kSample);
+
+    observer.Begin(MetricsPhase::kEvaluate);
+    observer.Count(MetricsCounter::kEvaluations,
+                   Evaluate(pop, evaluation, rng));
+    observer.End(MetricsPhase::kEvaluate);
+
+    observer.Begin(MetricsPhase::kUpdate);
     update(dist, pop, rng);
-    return termination(pop, rng);
+    observer.End(MetricsPhase::kUpdate);
+
+    observer.Begin(MetricsPhase::kTerminate);
+    bool result = termination(pop, rng);
+    observer.End(MetricsPhase::kTerminate);
+
+    observer.Observe(pop);
+    observer.EndGeneration();
+    return result;
   }
 
   /// Run the algorithm until the termination conditions have been met.
@@ -59,6 +83,18 @@ struct Eda {
   void Run(DistFunc& dist, Rng& rng) {
     while (!operator()<T, F>(dist, rng)) {}
   }
+
+  /// Write the termination state to a checkpoint. The distribution is saved
+  /// separately.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(termination);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(termination);
+  }
 };
 
 template <typename... Args>
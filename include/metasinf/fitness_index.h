@@ -0,0 +1,167 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_FITNESS_INDEX_H_
+#define METASINF_INCLUDE_METASINF_FITNESS_INDEX_H_
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snf {
+
+/// Index over the fitness of a population, which tracks its best and worst
+/// individuals.
+///
+/// The index is a tournament tree: every leaf holds the fitness of an
+/// individual and every inner node the winners of its subtree. It is built
+/// in linear time, and re-evaluating an individual only replays the matches
+/// on the path to the root, in logarithmic time. Ties are broken as in
+/// `FittestIndices`: of two equally fit individuals, the one with the higher
+/// index counts as the fitter, so it wins ties for the best and the lower
+/// index wins ties for the worst.
+///
+/// The index does not observe the population; the owner must call `Update`
+/// for every individual whose fitness changes.
+template <typename F>
+struct FitnessIndex {
+  FitnessIndex() : leaves_(0) {}
+
+  /// Index the fitness of the individuals of `pop`.
+  template <typename Pop>
+  void Build(const Pop& pop) {
+    fitness_.resize(pop.size());
+    for (size_t i = 0; i < pop.size(); ++i) {
+      fitness_[i] = pop[i].fitness;
+    }
+
+    leaves_ = 1;
+    while (leaves_ < fitness_.size()) {
+      leaves_ *= 2;
+    }
+
+    best_.resize(2 * leaves_);
+    worst_.resize(2 * leaves_);
+    for (size_t i = 0; i < leaves_; ++i) {
+      best_[leaves_ + i] = i;
+      worst_[leaves_ + i] = i;
+    }
+
+    for (size_t node = leaves_ - 1; node > 0; --node) {
+      Replay(node);
+    }
+  }
+
+  /// Set the fitness of the individual at `index`.
+  void Update(size_t index, F fitness) {
+    assert(index < fitness_.size());
+    fitness_[index] = fitness;
+    for (size_t node = (leaves_ + index) / 2; node > 0; node /= 2) {
+      Replay(node);
+    }
+  }
+
+  /// Return the number of indexed individuals.
+  size_t size() const { return fitness_.size(); }
+
+  /// Return whether the index is empty.
+  bool empty() const { return fitness_.empty(); }
+
+  /// Return the fitness of the individual at `index`.
+  F fitness(size_t index) const { return fitness_[index]; }
+
+  /// Return the index of the fittest individual.
+  size_t best() const {
+    assert(!empty());
+    return best_[1];
+  }
+
+  /// Return the index of the least fit individual.
+  size_t worst() const {
+    assert(!empty());
+    return worst_[1];
+  }
+
+ private:
+  std::vector<F> fitness_;
+  std::vector<size_t> best_;
+  std::vector<size_t> worst_;
+  size_t leaves_;
+
+  // Padding leaves lose every match. The right contender has the higher
+  // index.
+  size_t Better(size_t lhs, size_t rhs) const {
+    if (rhs >= size()) {
+      return lhs;
+    }
+
+    if (lhs >= size()) {
+      return rhs;
+    }
+
+    return fitness_[rhs] >= fitness_[lhs] ? rhs : lhs;
+  }
+
+  size_t Worse(size_t lhs, size_t rhs) const {
+    if (rhs >= size()) {
+      return lhs;
+    }
+
+    if (lhs >= size()) {
+      return rhs;
+    }
+
+    return fitness_[rhs] < fitness_[lhs] ? rhs : lhs;
+  }
+
+  void Replay(size_t node) {
+    best_[node] = Better(best_[2 * node], best_[2 * node + 1]);
+    worst_[node] = Worse(worst_[2 * node], worst_[2 * node + 1]);
+  }
+};
+
+/// Check whether a functor can query a fitness index.
+///
+/// Such a functor is called as `func(pop, index, rng)`, where `index` is a
+/// `FitnessIndex` that is up to date with `pop`, instead of scanning the
+/// population itself.
+template <typename Func, typename Pop, typename F, typename Rng>
+struct AcceptsFitnessIndex {
+  template <typename U>
+  static auto Test(U* func) -> decltype(
+      (*func)(std::declval<Pop&>(), std::declval<const FitnessIndex<F>&>(),
+              std::declval<Rng&>()),
+      std::true_type());
+
+  template <typename U>
+  static std::false_type Test(...);
+
+  static constexpr bool value = decltype(Test<Func>(nullptr))::value;
+};
+
+template <typename Func, typename Pop, typename F, typename Rng>
+auto CallIndexed(Func& func, Pop& pop, const FitnessIndex<F>& index, Rng& rng,
+                 std::true_type) -> decltype(func(pop, index, rng)) {
+  return func(pop, index, rng);
+}
+
+template <typename Func, typename Pop, typename F, typename Rng>
+auto CallIndexed(Func& func, Pop& pop, const FitnessIndex<F>& index, Rng& rng,
+                 std::false_type) -> decltype(func(pop, rng)) {
+  return func(pop, rng);
+}
+
+/// Call `func(pop, index, rng)` if the functor can query a fitness index, or
+/// `func(pop, rng)` otherwise.
+template <typename Func, typename Pop, typename F, typename Rng>
+auto CallIndexed(Func& func, Pop& pop, const FitnessIndex<F>& index, Rng& rng)
+    -> decltype(func(pop, rng)) {
+  return CallIndexed(func, pop, index, rng,
+                     std::integral_constant<bool, AcceptsFitnessIndex<
+                         Func, Pop, F, Rng>::value>());
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_FITNESS_INDEX_H_
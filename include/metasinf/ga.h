@@ -4,9 +4,20 @@
 #ifndef METASINF_INCLUDE_METASINF_GA_H_
 #define METASINF_INCLUDE_METASINF_GA_H_
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <random>
+#include <type_traits>
+#include <vector>
 
+#include "metasinf/delta.h"
+#include "metasinf/metrics.h"
+#include "metasinf/parallel.h"
 #include "metasinf/population.h"
+#include "metasinf/random.h"
+#include "metasinf/rate.h"
 
 namespace snf {
 
@@ -17,7 +28,9 @@ template <
     typename CrossoverFunc,
     typename MutationFunc,
     typename ReplacementFunc,
-    typename TerminationFunc>
+    typename TerminationFunc,
+    typename RateFunc = RateFixed,
+    typename ObserverFunc = ObserverNone>
 struct Ga {
   /// Construct a new simulation.
   Ga(double mutation_rate, double crossover_rate,
@@ -26,7 +39,9 @@ struct Ga {
      const CrossoverFunc& crossover = CrossoverFunc(),
      const MutationFunc& mutation = MutationFunc(),
      const ReplacementFunc& replacement = ReplacementFunc(),
-     const TerminationFunc& termination = TerminationFunc())
+     const TerminationFunc& termination = TerminationFunc(),
+     const RateFunc& rate = RateFunc(),
+     const ObserverFunc& observer = ObserverFunc())
       : mutation_rate(mutation_rate),
         crossover_rate(crossover_rate),
         evaluation(evaluation),
@@ -34,7 +49,10 @@ struct Ga {
         crossover(crossover),
         mutation(mutation),
         replacement(replacement),
-        termination(termination) {}
+        termination(termination),
+        rate(rate),
+        observer(observer),
+        tile_size(0) {}
 
   /// Mutation rate.
   double mutation_rate;
@@ -60,10 +78,40 @@ struct Ga {
   /// Termination functor.
   TerminationFunc termination;
 
+  /// Rate controller, which adapts the mutation and crossover rates after
+  /// every step from the outcome of the variation operators.
+  ///
+  /// With a controller other than `RateFixed`, the offspring are evaluated
+  /// before the replacement, so that each child can be compared with the
+  /// parent it was copied from.
+  RateFunc rate;
+
+  /// Observer, which is notified of the phases, the evaluations and the
+  /// variation operators of every step. It is shown the population once the
+  /// population has been evaluated, at the start of the step. The default
+  /// observer does nothing.
+  ObserverFunc observer;
+
+  /// Number of offspring processed per tile by the fused pipeline, or zero
+  /// to process every stage over the whole mating pool.
+  ///
+  /// The fused pipeline draws random pairs from the selection plan instead
+  /// of shuffling the mating pool; each tile of parents is then copied,
+  /// varied and evaluated while it is in cache, before it is moved into the
+  /// offspring population. The random number sequence differs from the
+  /// unfused pipeline, but not between tile sizes: the crossover and
+  /// mutation decisions are drawn for the whole mating pool up front, and
+  /// the pairing and the operators draw from their own generators, forked
+  /// from the one of the step. Only batch evaluators, which are called once
+  /// per tile, may see a different sequence. Choose a tile that fits in the
+  /// L1 or L2 cache. Selection functors without a selection plan always use
+  /// the unfused pipeline.
+  size_t tile_size;
+
   /// Perform the next evolution step.
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
-    thread_local Population<T, F> tmp;
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
+    thread_local Pop tmp;
 
     assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
     assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
@@ -71,47 +119,408 @@ struct Ga {
       return true;
     }
 
-    Evaluate(pop, evaluation, rng);
+    EvaluatePop(pop, rng);
+    observer.Observe(pop);
 
     tmp.clear();
-    selection(pop, tmp, rng);
-    if (tmp.empty()) {
-      return false;
+    if (tile_size > 0) {
+      Breed(pop, tmp, rng,
+            std::integral_constant<bool, HasSelectionPlan<
+                SelectionFunc, Pop, Rng>::value>());
+    } else {
+      Breed(pop, tmp, rng, std::false_type());
     }
 
-    std::shuffle(tmp.begin(), tmp.end(), rng);
-    std::bernoulli_distribution mutation_dist(mutation_rate);
-    std::bernoulli_distribution crossover_dist(crossover_rate);
-    for (size_t i = 0; i < tmp.size() / 2; ++i) {
-      Individual<T, F>& child0 = tmp[2 * i + 0];
-      Individual<T, F>& child1 = tmp[2 * i + 1];
+    return Finish(pop, tmp, rng);
+  }
+
+  /// Perform the next evolution step, applying the crossover and mutation
+  /// operators to the selected pairs in parallel.
+  ///
+  /// Every pair draws its random numbers from its own stream, derived from
+  /// a key drawn from `rng` once per generation and from the index of the
+  /// pair. The outcome therefore depends only on the state of `rng`, and not
+  /// on the executor or its number of workers. It differs from the outcome
+  /// of the serial overload. The operators and the delta evaluation, if
+  /// any, are invoked from multiple threads and must be thread-safe.
+  /// Selection functors with a parallel plan, like `SelectionTournament`,
+  /// plan the selection with the executor as well.
+  template <typename Pop, typename Rng, typename Executor>
+  bool operator()(Pop& pop, Rng& rng, Executor& executor) {
+    thread_local Pop tmp;
+
+    assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
+    assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
+    if (pop.empty()) {
+      return true;
+    }
+
+    EvaluatePop(pop, rng);
+    observer.Observe(pop);
+
+    observer.Begin(MetricsPhase::kSelect);
+    tmp.clear();
+    SelectShuffled(selection, pop, tmp, rng, executor);
+    observer.End(MetricsPhase::kSelect);
+
+    observer.Begin(MetricsPhase::kVary);
+    uint64_t key = rng();
+    key = (key << 32) ^ rng();
+
+    // The workers refer to the population of the calling thread.
+    Pop& children = tmp;
+    size_t pair_count = tmp.size() / 2;
+    Prepare(pair_count, Adaptive());
+    std::atomic<size_t> next(0);
+    std::atomic<uint64_t> crossovers(0);
+    std::atomic<uint64_t> mutations(0);
+    executor([&](size_t worker) {
+      uint64_t worker_crossovers = 0;
+      uint64_t worker_mutations = 0;
+      for (size_t i = next++; i < pair_count; i = next++) {
+        Rng stream = StreamRng<Rng>(key, i);
+        Vary(children[2 * i + 0], children[2 * i + 1], i, stream,
+             worker_crossovers, worker_mutations);
+      }
+
+      crossovers += worker_crossovers;
+      mutations += worker_mutations;
+    });
+
+    observer.Count(MetricsCounter::kCrossovers, crossovers);
+    observer.Count(MetricsCounter::kMutations, mutations);
+    observer.End(MetricsPhase::kVary);
+    return Finish(pop, tmp, rng);
+  }
+
+  /// Run the algorithm until the termination conditions have been met.
+  template <typename Pop, typename Rng>
+  void Run(Pop& pop, Rng& rng) {
+    while (!operator()(pop, rng)) {}
+  }
+
+  /// Run the algorithm until the termination conditions have been met,
+  /// using the specified executor for the variation stage.
+  template <typename Pop, typename Rng, typename Executor>
+  void Run(Pop& pop, Rng& rng, Executor& executor) {
+    while (!operator()(pop, rng, executor)) {}
+  }
+
+  /// Write the rates and the termination state to a checkpoint.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(mutation_rate);
+    writer.Write(crossover_rate);
+    writer.Write(termination);
+    writer.Write(rate);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(mutation_rate);
+    reader.Read(crossover_rate);
+    reader.Read(termination);
+    reader.Read(rate);
+  }
+
+ private:
+  // Select the mating pool, then apply the variation operators to it.
+  template <typename Pop, typename Rng>
+  void Breed(Pop& pop, Pop& tmp, Rng& rng, std::false_type) {
+    observer.Begin(MetricsPhase::kSelect);
+    SelectShuffled(selection, pop, tmp, rng);
+    observer.End(MetricsPhase::kSelect);
+
+    observer.Begin(MetricsPhase::kVary);
+    uint64_t crossovers = 0;
+    uint64_t mutations = 0;
+    Prepare(tmp.size() / 2, Adaptive());
+    VaryAll(tmp, 0, rng, crossovers, mutations);
+
+    observer.Count(MetricsCounter::kCrossovers, crossovers);
+    observer.Count(MetricsCounter::kMutations, mutations);
+    observer.End(MetricsPhase::kVary);
+  }
+
+  // Stream tiles of randomly paired parents through variation and
+  // evaluation.
+  template <typename Pop, typename Rng>
+  void Breed(Pop& pop, Pop& tmp, Rng& rng, std::true_type) {
+    thread_local std::vector<size_t> plan;
+    thread_local std::vector<size_t> crossed;
+    thread_local std::vector<size_t> mutated;
+    thread_local Pop tile;
+
+    observer.Begin(MetricsPhase::kSelect);
+    plan.clear();
+    selection.Plan(pop, plan, rng);
+    observer.End(MetricsPhase::kSelect);
+
+    size_t count = plan.size();
+    size_t step = tile_size + tile_size % 2;
+    uint64_t crossovers = 0;
+    uint64_t mutations = 0;
+    Prepare(count / 2, Adaptive());
+    tmp.reserve(count);
+
+    observer.Begin(MetricsPhase::kVary);
+    crossed.clear();
+    SampleBernoulli(crossover_rate, count / 2, crossed, rng);
+    mutated.clear();
+    SampleBernoulli(mutation_rate, count / 2 * 2, mutated, rng);
+    Rng pairing = ForkRng(rng);
+    Rng variation = ForkRng(rng);
+    size_t next_crossed = 0;
+    size_t next_mutated = 0;
+    observer.End(MetricsPhase::kVary);
+
+    for (size_t begin = 0; begin < count; begin += step) {
+      observer.Begin(MetricsPhase::kSelect);
+      size_t size = std::min(step, count - begin);
+      ResizeLike(tile, pop, size);
+      for (size_t i = 0; i < size; ++i) {
+        std::uniform_int_distribution<size_t> dist(begin + i, count - 1);
+        std::swap(plan[begin + i], plan[dist(pairing)]);
+        CopyIndividual(pop, plan[begin + i], tile, i);
+      }
+
+      observer.End(MetricsPhase::kSelect);
+
+      observer.Begin(MetricsPhase::kVary);
+      VaryTile(tile, begin / 2, crossed, next_crossed, mutated, next_mutated,
+               variation, crossovers, mutations);
+      observer.End(MetricsPhase::kVary);
+
+      EvaluatePop(tile, rng);
+      for (size_t i = 0; i < size; ++i) {
+        tmp.push_back(std::move(tile[i]));
+      }
+    }
+
+    observer.Count(MetricsCounter::kCrossovers, crossovers);
+    observer.Count(MetricsCounter::kMutations, mutations);
+  }
+
+  // Evaluate the dirty individuals of a population.
+  template <typename Pop, typename Rng>
+  void EvaluatePop(Pop& pop, Rng& rng) {
+    observer.Begin(MetricsPhase::kEvaluate);
+    observer.Count(MetricsCounter::kEvaluations,
+                   Evaluate(pop, evaluation, rng));
+    observer.End(MetricsPhase::kEvaluate);
+  }
+
+  // Replace the population with the offspring, check the termination
+  // conditions and end the generation of the observer.
+  template <typename Pop, typename Rng>
+  bool Finish(Pop& pop, Pop& tmp, Rng& rng) {
+    bool result = false;
+    if (!tmp.empty()) {
+      Adapt(tmp, rng, Adaptive());
+
+      observer.Begin(MetricsPhase::kReplace);
+      replacement(tmp, pop, rng);
+      observer.End(MetricsPhase::kReplace);
 
-      if (crossover_dist(rng)) {
+      observer.Begin(MetricsPhase::kTerminate);
+      result = termination(pop, rng);
+      observer.End(MetricsPhase::kTerminate);
+    }
+
+    observer.EndGeneration();
+    return result;
+  }
+
+  using Adaptive =
+      std::integral_constant<bool, !std::is_same<RateFunc, RateFixed>::value>;
+
+  enum : uint8_t { kCrossed = 1, kMutated0 = 2, kMutated1 = 4 };
+
+  // Size the record of the variation outcomes for `pair_count` pairs.
+  void Prepare(size_t pair_count, std::false_type) {}
+
+  void Prepare(size_t pair_count, std::true_type) {
+    parent_fitness_.resize(2 * pair_count);
+    outcomes_.resize(pair_count);
+  }
+
+  // Record the outcome of the variation of a pair.
+  void Record(size_t pair, double fitness0, double fitness1, uint8_t outcome,
+              std::false_type) {}
+
+  void Record(size_t pair, double fitness0, double fitness1, uint8_t outcome,
+              std::true_type) {
+    parent_fitness_[2 * pair + 0] = fitness0;
+    parent_fitness_[2 * pair + 1] = fitness1;
+    outcomes_[pair] = outcome;
+  }
+
+  // Record the fitness of the parents of the pairs of `pop`, numbered from
+  // `first_pair`, before their variation.
+  template <typename Pop>
+  void RecordParents(const Pop& pop, size_t first_pair, std::false_type) {}
+
+  template <typename Pop>
+  void RecordParents(const Pop& pop, size_t first_pair, std::true_type) {
+    for (size_t i = 0; i < pop.size() / 2; ++i) {
+      Record(first_pair + i, pop[2 * i + 0].fitness, pop[2 * i + 1].fitness, 0,
+             std::true_type());
+    }
+  }
+
+  // Record that an operator has been applied to a pair.
+  void RecordOutcome(size_t pair, uint8_t outcome, std::false_type) {}
+
+  void RecordOutcome(size_t pair, uint8_t outcome, std::true_type) {
+    outcomes_[pair] |= outcome;
+  }
+
+  // Apply the crossover and mutation operators to the pairs of `pop`,
+  // numbered from `first_pair`.
+  //
+  // The crossover and mutation decisions of all pairs are drawn up front, so
+  // that the operators are only invoked on the selected pairs and children.
+  // Every crossover is performed before the mutations, which preserves the
+  // order of the operators within each pair.
+  template <typename Pop, typename Rng>
+  void VaryAll(Pop& pop, size_t first_pair, Rng& rng, uint64_t& crossovers,
+               uint64_t& mutations) {
+    thread_local std::vector<size_t> selected;
+
+    size_t pair_count = pop.size() / 2;
+    RecordParents(pop, first_pair, Adaptive());
+
+    selected.clear();
+    SampleBernoulli(crossover_rate, pair_count, selected, rng);
+    for (size_t i : selected) {
+      auto&& child0 = pop[2 * i + 0];
+      auto&& child1 = pop[2 * i + 1];
+      crossover(child0.data, child1.data, rng);
+      child0.mark_dirty();
+      child1.mark_dirty();
+      RecordOutcome(first_pair + i, kCrossed, Adaptive());
+    }
+
+    crossovers += selected.size();
+
+    selected.clear();
+    SampleBernoulli(mutation_rate, 2 * pair_count, selected, rng);
+    for (size_t i : selected) {
+      Mutate(mutation, evaluation, pop[i], rng);
+      RecordOutcome(first_pair + i / 2, i % 2 == 0 ? kMutated0 : kMutated1,
+                    Adaptive());
+    }
+
+    mutations += selected.size();
+  }
+
+  // Apply the crossover and mutation operators to the pairs of the tile
+  // `pop`, numbered from `first_pair`, as decided for the whole mating pool.
+  // `crossed` holds the crossed pairs and `mutated` the mutated children,
+  // numbered across the mating pool in ascending order; the cursors are
+  // advanced past the entries of the tile. Every pair is crossed before its
+  // children are mutated, and the pairs are visited in order, so the random
+  // numbers drawn from `rng` do not depend on the tile size.
+  template <typename Pop, typename Rng>
+  void VaryTile(Pop& pop, size_t first_pair, const std::vector<size_t>& crossed,
+                size_t& next_crossed, const std::vector<size_t>& mutated,
+                size_t& next_mutated, Rng& rng, uint64_t& crossovers,
+                uint64_t& mutations) {
+    RecordParents(pop, first_pair, Adaptive());
+    for (size_t i = 0; i < pop.size() / 2; ++i) {
+      size_t pair = first_pair + i;
+      if (next_crossed < crossed.size() && crossed[next_crossed] == pair) {
+        auto&& child0 = pop[2 * i + 0];
+        auto&& child1 = pop[2 * i + 1];
         crossover(child0.data, child1.data, rng);
         child0.mark_dirty();
         child1.mark_dirty();
+        RecordOutcome(pair, kCrossed, Adaptive());
+        ++next_crossed;
+        ++crossovers;
       }
 
-      if (mutation_dist(rng)) {
-        mutation(child0.data, rng);
-        child0.mark_dirty();
+      for (; next_mutated < mutated.size() && mutated[next_mutated] / 2 == pair;
+           ++next_mutated) {
+        size_t child = mutated[next_mutated] % 2;
+        Mutate(mutation, evaluation, pop[2 * i + child], rng);
+        RecordOutcome(pair, child == 0 ? kMutated0 : kMutated1, Adaptive());
+        ++mutations;
       }
+    }
+  }
 
-      if (mutation_dist(rng)) {
-        mutation(child1.data, rng);
-        child1.mark_dirty();
+  // Evaluate the offspring and update the rates from their outcomes.
+  template <typename Pop, typename Rng>
+  void Adapt(Pop& tmp, Rng& rng, std::false_type) {}
+
+  template <typename Pop, typename Rng>
+  void Adapt(Pop& tmp, Rng& rng, std::true_type) {
+    EvaluatePop(tmp, rng);
+
+    RateFeedback feedback;
+    for (size_t i = 0; i < outcomes_.size(); ++i) {
+      bool improved0 = tmp[2 * i + 0].fitness > parent_fitness_[2 * i + 0];
+      bool improved1 = tmp[2 * i + 1].fitness > parent_fitness_[2 * i + 1];
+      feedback.offspring += 2;
+      feedback.improved += improved0 + improved1;
+      if (outcomes_[i] & kCrossed) {
+        ++feedback.crossovers;
+        feedback.crossover_successes += improved0 || improved1;
+      }
+
+      if (outcomes_[i] & kMutated0) {
+        ++feedback.mutations;
+        feedback.mutation_successes += improved0;
+      }
+
+      if (outcomes_[i] & kMutated1) {
+        ++feedback.mutations;
+        feedback.mutation_successes += improved1;
       }
     }
 
-    replacement(tmp, pop, rng);
-    return termination(pop, rng);
+    rate(mutation_rate, crossover_rate, feedback, rng);
+    assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
+    assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
   }
 
-  /// Run the algorithm until the termination conditions have been met.
-  template <typename T, typename F, typename Rng>
-  void Run(Population<T, F>& pop, Rng& rng) {
-    while (!operator()(pop, rng)) {}
+  // Apply the crossover and mutation operators to the pair of parents with
+  // the specified index.
+  template <typename Ind, typename Rng>
+  void Vary(Ind&& child0, Ind&& child1, size_t pair, Rng& rng,
+            uint64_t& crossovers, uint64_t& mutations) {
+    double fitness0 = child0.fitness;
+    double fitness1 = child1.fitness;
+    uint8_t outcome = 0;
+
+    std::bernoulli_distribution mutation_dist(mutation_rate);
+    std::bernoulli_distribution crossover_dist(crossover_rate);
+    if (crossover_dist(rng)) {
+      crossover(child0.data, child1.data, rng);
+      child0.mark_dirty();
+      child1.mark_dirty();
+      ++crossovers;
+      outcome |= kCrossed;
+    }
+
+    if (mutation_dist(rng)) {
+      Mutate(mutation, evaluation, child0, rng);
+      ++mutations;
+      outcome |= kMutated0;
+    }
+
+    if (mutation_dist(rng)) {
+      Mutate(mutation, evaluation, child1, rng);
+      ++mutations;
+      outcome |= kMutated1;
+    }
+
+    Record(pair, fitness0, fitness1, outcome, Adaptive());
   }
+
+  std::vector<double> parent_fitness_;
+  std::vector<uint8_t> outcomes_;
 };
 
 template <typename... Args>
@@ -0,0 +1,617 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_HYPERVOLUME_H_
+#define METASINF_INCLUDE_METASINF_HYPERVOLUME_H_
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/nsga2.h"
+
+namespace snf {
+
+/// Exact hypervolume of a set of points, with the WFG algorithm.
+///
+/// The points are stored row by row in a flat vector, with one column for
+/// every objective of the reference point. All objectives are maximized, so
+/// the hypervolume is the volume of the region that is dominated by the
+/// points and dominates the reference point. Points that do not dominate the
+/// reference point strictly add nothing.
+///
+/// The points are sliced along their last objective, and each slice adds
+/// the exclusive volume of a point in one objective less. That volume is
+/// bounded by the limit set of the point, i.e. the points after it clipped
+/// to its box, whose dominated members are dropped before recursing. Two
+/// objectives are swept directly. The scratch space is kept between calls.
+template <typename F>
+struct Hypervolume {
+  Hypervolume() : objectives_(0) {}
+
+  /// Return the hypervolume of `points`.
+  F Volume(const std::vector<F>& points, const std::vector<F>& reference) {
+    Level& level = Load(points, reference, reference.size());
+    return Wfg(level, reference.size());
+  }
+
+  /// Return the exclusive contribution of the point at `index` to the
+  /// hypervolume of `points`, i.e. the volume that is lost without it.
+  F Contribution(const std::vector<F>& points, size_t index,
+                 const std::vector<F>& reference) {
+    size_t n = reference.size();
+    assert(n > 0 && index < points.size() / n);
+    const F* point = points.data() + index * n;
+    for (size_t i = 0; i < n; ++i) {
+      if (!(point[i] > reference[i])) {
+        return 0;
+      }
+    }
+
+    // Load the other points into the scratch level of one more objective,
+    // which the recursion never uses.
+    others_.assign(points.begin(), points.begin() + index * n);
+    others_.insert(others_.end(), points.begin() + (index + 1) * n,
+                   points.end());
+
+    Level& level = Load(others_, reference, n + 1);
+    order_.resize(level.count);
+    for (size_t i = 0; i < order_.size(); ++i) {
+      order_[i] = i;
+    }
+
+    return Exclusive(point, level.rows.data(), order_.data(), order_.size(),
+                     n, n);
+  }
+
+ private:
+  // Rows of one depth of the recursion, with as many columns as objectives
+  // remain.
+  struct Level {
+    Level() : count(0) {}
+
+    std::vector<F> rows;
+    std::vector<F> clipped;
+    std::vector<size_t> order;
+    size_t count;
+  };
+
+  std::vector<Level> levels_;
+  std::vector<F> reference_;
+  std::vector<F> others_;
+  std::vector<size_t> order_;
+  size_t objectives_;
+
+  // Copy the points that dominate the reference point into `levels_[depth]`.
+  Level& Load(const std::vector<F>& points, const std::vector<F>& reference,
+              size_t depth) {
+    objectives_ = reference.size();
+    assert(objectives_ > 0 && points.size() % objectives_ == 0);
+    reference_ = reference;
+    if (levels_.size() < objectives_ + 2) {
+      levels_.resize(objectives_ + 2);
+    }
+
+    Level& level = levels_[depth];
+    level.rows.resize(points.size());
+    level.count = 0;
+    for (size_t i = 0; i < points.size(); i += objectives_) {
+      bool inside = true;
+      for (size_t j = 0; j < objectives_; ++j) {
+        inside = inside && points[i + j] > reference_[j];
+      }
+
+      if (inside) {
+        std::copy(points.begin() + i, points.begin() + i + objectives_,
+                  level.rows.begin() + level.count * objectives_);
+        ++level.count;
+      }
+    }
+
+    return level;
+  }
+
+  // Return the hypervolume of the rows of a level with `n` objectives.
+  F Wfg(Level& level, size_t n) {
+    const F* rows = level.rows.data();
+    if (level.count == 0) {
+      return 0;
+    }
+
+    if (n == 1) {
+      return *std::max_element(rows, rows + level.count) - reference_[0];
+    }
+
+    std::vector<size_t>& order = level.order;
+    order.resize(level.count);
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+
+    if (n == 2) {
+      std::sort(order.begin(), order.end(), [rows](size_t lhs, size_t rhs) {
+        return rows[2 * lhs] > rows[2 * rhs] ||
+               (rows[2 * lhs] == rows[2 * rhs] &&
+                rows[2 * lhs + 1] > rows[2 * rhs + 1]);
+      });
+
+      F volume = 0;
+      F height = reference_[1];
+      for (size_t i : order) {
+        if (rows[2 * i + 1] > height) {
+          volume += (rows[2 * i] - reference_[0]) * (rows[2 * i + 1] - height);
+          height = rows[2 * i + 1];
+        }
+      }
+
+      return volume;
+    }
+
+    // Above the last objective of a point, its box only overlaps the boxes
+    // of the points after it.
+    size_t last = n - 1;
+    std::sort(order.begin(), order.end(),
+              [rows, n, last](size_t lhs, size_t rhs) {
+                return rows[lhs * n + last] < rows[rhs * n + last];
+              });
+
+    F volume = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const F* point = rows + order[i] * n;
+      volume += (point[last] - reference_[last]) *
+                Exclusive(point, rows, order.data() + i + 1,
+                          order.size() - i - 1, last, n);
+    }
+
+    return volume;
+  }
+
+  // Return the volume that `point` adds to the `count` rows at `others`, in
+  // their first `n` objectives. The rows have `stride` columns.
+  F Exclusive(const F* point, const F* rows, const size_t* others,
+              size_t count, size_t n, size_t stride) {
+    F volume = 1;
+    for (size_t i = 0; i < n; ++i) {
+      volume *= point[i] - reference_[i];
+    }
+
+    if (count == 0) {
+      return volume;
+    }
+
+    // Clip the other points to the box of the point, and keep the ones that
+    // are not weakly dominated by another. Visiting them best first, none
+    // can dominate one that was kept before it.
+    Level& limit = levels_[n];
+    limit.clipped.resize(count * n);
+    limit.order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      const F* other = rows + others[i] * stride;
+      for (size_t j = 0; j < n; ++j) {
+        limit.clipped[i * n + j] = std::min(point[j], other[j]);
+      }
+
+      limit.order[i] = i;
+    }
+
+    const F* clipped = limit.clipped.data();
+    std::sort(limit.order.begin(), limit.order.end(),
+              [clipped, n](size_t lhs, size_t rhs) {
+                return std::lexicographical_compare(
+                    clipped + rhs * n, clipped + rhs * n + n,
+                    clipped + lhs * n, clipped + lhs * n + n);
+              });
+
+    limit.rows.resize(count * n);
+    limit.count = 0;
+    for (size_t i : limit.order) {
+      const F* row = clipped + i * n;
+      bool dominated = false;
+      for (size_t k = 0; k < limit.count && !dominated; ++k) {
+        const F* kept = limit.rows.data() + k * n;
+        size_t j = 0;
+        while (j < n && kept[j] >= row[j]) {
+          ++j;
+        }
+
+        dominated = j == n;
+      }
+
+      if (!dominated) {
+        std::copy(row, row + n, limit.rows.begin() + limit.count * n);
+        ++limit.count;
+      }
+    }
+
+    return volume - Wfg(limit, n);
+  }
+};
+
+/// Estimate the volume of the part of the box between `lower` and `upper`
+/// that is dominated by the `count` points of `points`.
+template <typename F, typename Rng>
+F EstimateVolume(const std::vector<F>& points, size_t count,
+                 const std::vector<F>& lower, const std::vector<F>& upper,
+                 size_t samples, Rng& rng) {
+  thread_local std::vector<F> clipped;
+  thread_local std::vector<F> sample;
+
+  size_t n = lower.size();
+  F box = 1;
+  for (size_t j = 0; j < n; ++j) {
+    box *= upper[j] - lower[j];
+  }
+
+  // Only the points that reach into the box can dominate a sample, and
+  // only up to its upper corner.
+  clipped.clear();
+  for (size_t i = 0; i < count; ++i) {
+    const F* point = points.data() + i * n;
+    bool inside = true;
+    for (size_t j = 0; j < n; ++j) {
+      inside = inside && point[j] > lower[j];
+    }
+
+    if (inside) {
+      for (size_t j = 0; j < n; ++j) {
+        clipped.push_back(std::min(point[j], upper[j]));
+      }
+    }
+  }
+
+  if (samples == 0 || clipped.empty() || !(box > 0)) {
+    return 0;
+  }
+
+  size_t hits = 0;
+  sample.resize(n);
+  std::uniform_real_distribution<F> dist(0, 1);
+  for (size_t s = 0; s < samples; ++s) {
+    for (size_t j = 0; j < n; ++j) {
+      sample[j] = lower[j] + dist(rng) * (upper[j] - lower[j]);
+    }
+
+    for (size_t i = 0; i < clipped.size(); i += n) {
+      size_t j = 0;
+      while (j < n && clipped[i + j] >= sample[j]) {
+        ++j;
+      }
+
+      if (j == n) {
+        ++hits;
+        break;
+      }
+    }
+  }
+
+  return box * hits / samples;
+}
+
+/// Estimate the hypervolume of `points` from `samples` points drawn
+/// uniformly from the box between the reference point and the best value of
+/// every objective.
+///
+/// The error does not depend on the number of objectives, which makes the
+/// estimate the only practical choice beyond a handful of them.
+template <typename F, typename Rng>
+F HypervolumeMonteCarlo(const std::vector<F>& points,
+                        const std::vector<F>& reference, size_t samples,
+                        Rng& rng) {
+  size_t n = reference.size();
+  assert(n > 0 && points.size() % n == 0);
+  std::vector<F> upper(reference);
+  for (size_t i = 0; i < points.size(); i += n) {
+    for (size_t j = 0; j < n; ++j) {
+      upper[j] = std::max(upper[j], points[i + j]);
+    }
+  }
+
+  return EstimateVolume(points, points.size() / n, reference, upper, samples,
+                        rng);
+}
+
+/// Estimate the exclusive contribution of the point at `index` to the
+/// hypervolume of `points` from `samples` points drawn uniformly from its
+/// box.
+template <typename F, typename Rng>
+F ContributionMonteCarlo(const std::vector<F>& points, size_t index,
+                         const std::vector<F>& reference, size_t samples,
+                         Rng& rng) {
+  thread_local std::vector<F> others;
+
+  size_t n = reference.size();
+  assert(n > 0 && index < points.size() / n);
+  std::vector<F> upper(points.begin() + index * n,
+                       points.begin() + (index + 1) * n);
+  for (size_t j = 0; j < n; ++j) {
+    if (!(upper[j] > reference[j])) {
+      return 0;
+    }
+  }
+
+  // The samples missed by every other point are exclusive to this one.
+  others.assign(points.begin(), points.begin() + index * n);
+  others.insert(others.end(), points.begin() + (index + 1) * n, points.end());
+  F box = 1;
+  for (size_t j = 0; j < n; ++j) {
+    box *= upper[j] - reference[j];
+  }
+
+  return box - EstimateVolume(others, others.size() / n, reference, upper,
+                              samples, rng);
+}
+
+/// Replace the individuals with the least hypervolume contributions, as in
+/// SMS-EMOA.
+///
+/// The offspring join the population, which is then sorted into
+/// non-dominated fronts. The best fronts survive whole, and the least
+/// contributors of the first front that does not fit are removed one at a
+/// time until the population has its original size. All individuals must
+/// have been evaluated. Sets the rank of the survivors, and their crowding
+/// distance within the surviving part of their front, so that it can serve
+/// as the replacement functor of `Nsga2`, which then performs SMS-EMOA.
+///
+/// Removing a point only changes the contributions of the points whose limit
+/// sets it bounded, so only those are recomputed after each removal. Up to
+/// `kExactObjectives` objectives the contributions are exact. Beyond that
+/// they are estimated from `samples` points drawn once per replacement;
+/// every point keeps the list of the samples that it dominates, so a
+/// removal only visits those.
+struct ReplacementHypervolume {
+  enum : size_t { kExactObjectives = 5 };
+
+  explicit ReplacementHypervolume(
+      const std::vector<double>& reference = std::vector<double>(),
+      size_t samples = 10000)
+      : reference(reference), samples(samples) {}
+
+  /// Reference point. If empty, it lies one unit below the worst value of
+  /// every objective in the front.
+  std::vector<double> reference;
+
+  /// Number of samples used to estimate the contributions.
+  size_t samples;
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<std::vector<size_t>> fronts;
+    thread_local std::vector<size_t> survivors;
+    thread_local std::vector<size_t> kept;
+
+    size_t size = dst.empty() ? src.size() : dst.size();
+    dst.reserve(dst.size() + src.size());
+    std::move(src.begin(), src.end(), std::back_inserter(dst));
+    src.clear();
+
+    SortNonDominated(dst, fronts);
+    survivors.clear();
+    for (const auto& front : fronts) {
+      if (survivors.size() + front.size() <= size) {
+        AssignCrowding(dst, front);
+        survivors.insert(survivors.end(), front.begin(), front.end());
+        continue;
+      }
+
+      size_t first = survivors.size();
+      Reduce(dst, front, size - first, survivors, rng);
+      kept.assign(survivors.begin() + first, survivors.end());
+      AssignCrowding(dst, kept);
+      break;
+    }
+
+    KeepSurvivors(dst, survivors);
+  }
+
+ private:
+  // Append the `count` individuals of `front` to keep to `survivors`.
+  template <typename Pop, typename Rng>
+  void Reduce(Pop& pop, const std::vector<size_t>& front, size_t count,
+              std::vector<size_t>& survivors, Rng& rng) {
+    using F = typename std::decay<decltype(pop[0].objectives[0])>::type;
+    thread_local std::vector<F> points;
+
+    size_t n = pop[front[0]].objectives.size();
+    std::vector<F> lower(n);
+    for (size_t j = 0; j < n; ++j) {
+      if (reference.empty()) {
+        lower[j] = pop[front[0]].objectives[j];
+        for (size_t index : front) {
+          lower[j] = std::min(lower[j], pop[index].objectives[j]);
+        }
+
+        lower[j] -= 1;
+      } else {
+        assert(reference.size() == n);
+        lower[j] = static_cast<F>(reference[j]);
+      }
+    }
+
+    points.clear();
+    for (size_t index : front) {
+      const auto& objectives = pop[index].objectives;
+      points.insert(points.end(), objectives.begin(), objectives.end());
+    }
+
+    if (n <= kExactObjectives) {
+      ReduceExact(points, lower, count, front, survivors);
+    } else {
+      ReduceSampled(points, lower, count, front, survivors, rng);
+    }
+  }
+
+  // Remove the least contributors of the points of `front`, recomputing the
+  // contributions that each removal changes.
+  template <typename F>
+  void ReduceExact(std::vector<F>& points, const std::vector<F>& lower,
+                   size_t count, const std::vector<size_t>& front,
+                   std::vector<size_t>& survivors) {
+    thread_local Hypervolume<F> hypervolume;
+    thread_local std::vector<F> removed;
+    thread_local std::vector<F> contributions;
+    thread_local std::vector<size_t> alive;
+
+    size_t n = lower.size();
+    alive.assign(front.begin(), front.end());
+    contributions.resize(alive.size());
+    for (size_t i = 0; i < alive.size(); ++i) {
+      contributions[i] = hypervolume.Contribution(points, i, lower);
+    }
+
+    while (alive.size() > count) {
+      size_t worst = std::min_element(contributions.begin(),
+                                      contributions.end()) -
+                     contributions.begin();
+      size_t last = alive.size() - 1;
+      removed.assign(points.begin() + worst * n,
+                     points.begin() + (worst + 1) * n);
+      std::copy(points.begin() + last * n, points.end(),
+                points.begin() + worst * n);
+      points.resize(last * n);
+      alive[worst] = alive[last];
+      alive.pop_back();
+      contributions[worst] = contributions[last];
+      contributions.pop_back();
+
+      for (size_t i = 0; i < alive.size(); ++i) {
+        if (Bounded(points, i, removed)) {
+          contributions[i] = hypervolume.Contribution(points, i, lower);
+        }
+      }
+    }
+
+    survivors.insert(survivors.end(), alive.begin(), alive.end());
+  }
+
+  // Remove the least contributors of the points of `front`, estimated from
+  // one set of samples of the box of the front, as in HypE. A sample that
+  // is dominated by a single point counts towards its contribution; every
+  // sample tracks the number and the sum of the positions of its
+  // dominators, and every point the samples it dominates, so a removal
+  // only revisits those.
+  template <typename F, typename Rng>
+  void ReduceSampled(const std::vector<F>& points,
+                     const std::vector<F>& lower, size_t count,
+                     const std::vector<size_t>& front,
+                     std::vector<size_t>& survivors, Rng& rng) {
+    thread_local std::vector<F> drawn;
+    thread_local std::vector<size_t> dominators;
+    thread_local std::vector<size_t> sums;
+    thread_local std::vector<size_t> exclusive;
+    thread_local std::vector<char> alive;
+    thread_local std::vector<size_t> offsets;
+    thread_local std::vector<size_t> dominated;
+
+    size_t n = lower.size();
+    std::vector<F> upper(lower);
+    for (size_t i = 0; i < points.size(); i += n) {
+      for (size_t j = 0; j < n; ++j) {
+        upper[j] = std::max(upper[j], points[i + j]);
+      }
+    }
+
+    auto dominates = [&](size_t position, size_t sample) {
+      const F* point = points.data() + position * n;
+      const F* row = drawn.data() + sample * n;
+      size_t j = 0;
+      while (j < n && point[j] >= row[j]) {
+        ++j;
+      }
+
+      return j == n;
+    };
+
+    drawn.resize(samples * n);
+    std::uniform_real_distribution<F> dist(0, 1);
+    for (size_t i = 0; i < drawn.size(); ++i) {
+      size_t j = i % n;
+      drawn[i] = lower[j] + dist(rng) * (upper[j] - lower[j]);
+    }
+
+    // The samples dominated by the point at position `i` are
+    // `dominated[offsets[i]]` to `dominated[offsets[i + 1] - 1]`.
+    dominators.assign(samples, 0);
+    sums.assign(samples, 0);
+    offsets.assign(1, 0);
+    dominated.clear();
+    for (size_t i = 0; i < front.size(); ++i) {
+      for (size_t s = 0; s < samples; ++s) {
+        if (dominates(i, s)) {
+          ++dominators[s];
+          sums[s] += i;
+          dominated.push_back(s);
+        }
+      }
+
+      offsets.push_back(dominated.size());
+    }
+
+    exclusive.assign(front.size(), 0);
+    alive.assign(front.size(), 1);
+    for (size_t s = 0; s < samples; ++s) {
+      if (dominators[s] == 1) {
+        ++exclusive[sums[s]];
+      }
+    }
+
+    for (size_t left = front.size(); left > count; --left) {
+      size_t worst = front.size();
+      for (size_t i = 0; i < front.size(); ++i) {
+        if (alive[i] &&
+            (worst == front.size() || exclusive[i] < exclusive[worst])) {
+          worst = i;
+        }
+      }
+
+      alive[worst] = 0;
+      for (size_t k = offsets[worst]; k < offsets[worst + 1]; ++k) {
+        size_t s = dominated[k];
+        --dominators[s];
+        sums[s] -= worst;
+        if (dominators[s] == 1) {
+          ++exclusive[sums[s]];
+        }
+      }
+    }
+
+    for (size_t i = 0; i < front.size(); ++i) {
+      if (alive[i]) {
+        survivors.push_back(front[i]);
+      }
+    }
+  }
+
+  // Return whether `removed`, clipped to the box of the point at `index`,
+  // is not weakly dominated by another point clipped to that box.
+  template <typename F>
+  static bool Bounded(const std::vector<F>& points, size_t index,
+                      const std::vector<F>& removed) {
+    size_t n = removed.size();
+    const F* point = points.data() + index * n;
+    for (size_t i = 0; i < points.size(); i += n) {
+      if (i == index * n) {
+        continue;
+      }
+
+      size_t j = 0;
+      while (j < n && std::min(point[j], points[i + j]) >=
+                          std::min(point[j], removed[j])) {
+        ++j;
+      }
+
+      if (j == n) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_HYPERVOLUME_H_
@@ -4,6 +4,11 @@
 #ifndef METASINF_INCLUDE_METASINF_ISLAND_MODEL_H_
 #define METASINF_INCLUDE_METASINF_ISLAND_MODEL_H_
 
+#include <atomic>
+#include <vector>
+
+#include "metasinf/metrics.h"
+#include "metasinf/parallel.h"
 #include "metasinf/population.h"
 
 namespace snf {
@@ -24,6 +29,19 @@ struct Island {
   bool operator()(Rng& rng) {
     return ga(pop, rng);
   }
+
+  /// Write the population and the algorithm state to a checkpoint.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(pop);
+    writer.Write(ga);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(pop);
+    reader.Read(ga);
+  }
 };
 
 /// Island model implementation.
@@ -31,12 +49,15 @@ struct Island {
 /// The population is divided into multiple subpopulations. These
 /// subpopulations evolve independently for a certain number of generations.
 /// A number of individuals are then distributed between the subpopulations.
-template <typename MigrationFunc>
+template <typename MigrationFunc, typename ObserverFunc = ObserverNone>
 struct IslandModel {
   /// Construct a new simulation.
   IslandModel(int migration_rate,
-              const MigrationFunc& migration = MigrationFunc())
-      : migration_rate(migration_rate), migration(migration) {}
+              const MigrationFunc& migration = MigrationFunc(),
+              const ObserverFunc& observer = ObserverFunc())
+      : migration_rate(migration_rate),
+        migration(migration),
+        observer(observer) {}
 
   /// Migration rate.
   int migration_rate;
@@ -44,25 +65,74 @@ struct IslandModel {
   /// Migration functor.
   MigrationFunc migration;
 
+  /// Observer, which is notified of the evolution and migration phases of
+  /// every step and shown the population of every island. Each island has
+  /// the observer of its own genetic algorithm, which is invoked from the
+  /// workers of the executor in the concurrent overload.
+  ObserverFunc observer;
+
   /// Perform the next evolution step.
   template <typename T, typename F, typename Ga, typename Rng>
   bool operator()(std::vector<Island<T, F, Ga>>& islands, Rng& rng) {
     assert(migration_rate > 0);
     for (int i = 0; i < migration_rate; ++i) {
       bool result = false;
+      observer.Begin(MetricsPhase::kEvolve);
       for (auto& it : islands) {
         if (it(rng)) {
           result = true;
         }
       }
 
+      observer.End(MetricsPhase::kEvolve);
       if (result) {
-        return true;
+        return Finish(islands, true);
       }
     }
 
+    observer.Begin(MetricsPhase::kMigrate);
     migration(islands, rng);
-    return false;
+    observer.End(MetricsPhase::kMigrate);
+    return Finish(islands, false);
+  }
+
+  /// Perform the next evolution step, evolving the islands concurrently.
+  ///
+  /// Each island is stepped with its own random number generator, derived
+  /// from the specified one, regardless of the worker it runs on.
+  template <typename T, typename F, typename Ga, typename Rng,
+            typename Executor>
+  bool operator()(std::vector<Island<T, F, Ga>>& islands, Rng& rng,
+                  Executor& executor) {
+    assert(migration_rate > 0);
+    std::vector<Rng> streams;
+    streams.reserve(islands.size());
+    for (size_t i = 0; i < islands.size(); ++i) {
+      streams.push_back(ForkRng(rng));
+    }
+
+    for (int i = 0; i < migration_rate; ++i) {
+      std::atomic<bool> result(false);
+      std::atomic<size_t> next(0);
+      observer.Begin(MetricsPhase::kEvolve);
+      executor([&](size_t worker) {
+        for (size_t j = next++; j < islands.size(); j = next++) {
+          if (islands[j](streams[j])) {
+            result = true;
+          }
+        }
+      });
+
+      observer.End(MetricsPhase::kEvolve);
+      if (result) {
+        return Finish(islands, true);
+      }
+    }
+
+    observer.Begin(MetricsPhase::kMigrate);
+    migration(islands, rng);
+    observer.End(MetricsPhase::kMigrate);
+    return Finish(islands, false);
   }
 
   /// Run the algorithm until the termination conditions have been met.
@@ -70,6 +140,27 @@ struct IslandModel {
   void Run(std::vector<Island<T, F, Ga>>& islands, Rng& rng) {
     while (!operator()(islands, rng)) {}
   }
+
+  /// Run the algorithm concurrently until the termination conditions have
+  /// been met.
+  template <typename T, typename F, typename Ga, typename Rng,
+            typename Executor>
+  void Run(std::vector<Island<T, F, Ga>>& islands, Rng& rng,
+           Executor& executor) {
+    while (!operator()(islands, rng, executor)) {}
+  }
+
+ private:
+  // Show the island populations to the observer and close its generation.
+  template <typename T, typename F, typename Ga>
+  bool Finish(const std::vector<Island<T, F, Ga>>& islands, bool result) {
+    for (const auto& it : islands) {
+      observer.Observe(it.pop);
+    }
+
+    observer.EndGeneration();
+    return result;
+  }
 };
 
 }  // namespace snf
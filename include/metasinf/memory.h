@@ -0,0 +1,62 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_MEMORY_H_
+#define METASINF_INCLUDE_METASINF_MEMORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace snf {
+
+/// Allocator that aligns every allocation to the specified boundary.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() {}
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t count) {
+    size_t size = count * sizeof(T) + Alignment + sizeof(void*);
+    char* raw = static_cast<char*>(::operator new(size));
+    uintptr_t address = reinterpret_cast<uintptr_t>(raw + sizeof(void*));
+    address = (address + Alignment - 1) & ~static_cast<uintptr_t>(
+        Alignment - 1);
+
+    void** aligned = reinterpret_cast<void**>(address);
+    aligned[-1] = raw;
+    return reinterpret_cast<T*>(aligned);
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    ::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+  }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return false;
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_MEMORY_H_
@@ -0,0 +1,318 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_METRICS_H_
+#define METASINF_INCLUDE_METASINF_METRICS_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "metasinf/stats.h"
+
+namespace snf {
+
+/// Phases of an evolution step.
+enum class MetricsPhase {
+  kEvaluate,
+  kSelect,
+  kVary,
+  kReplace,
+  kTerminate,
+  kSample,
+  kUpdate,
+  kEvolve,
+  kMigrate,
+  kCount
+};
+
+/// Events counted during an evolution step.
+enum class MetricsCounter {
+  kEvaluations,
+  kCrossovers,
+  kMutations,
+  kCount
+};
+
+inline const char* MetricsPhaseName(MetricsPhase phase) {
+  static const char* const kNames[] = {
+      "evaluate", "select", "vary", "replace", "terminate",
+      "sample", "update", "evolve", "migrate"};
+  return kNames[static_cast<int>(phase)];
+}
+
+inline const char* MetricsCounterName(MetricsCounter counter) {
+  static const char* const kNames[] = {"evaluations", "crossovers",
+                                       "mutations"};
+  return kNames[static_cast<int>(counter)];
+}
+
+/// Observer that ignores every event.
+///
+/// An observer is notified by the engines when a phase begins and ends,
+/// when events are counted, and when a generation ends, after it has been
+/// shown the populations through `Observe`. Every call of this observer
+/// compiles to nothing.
+struct ObserverNone {
+  void Begin(MetricsPhase phase) {}
+  void End(MetricsPhase phase) {}
+  void Count(MetricsCounter counter, uint64_t count) {}
+
+  template <typename Pop>
+  void Observe(const Pop& pop) {}
+
+  void EndGeneration() {}
+};
+
+/// Metrics of a single generation.
+struct GenerationMetrics {
+  GenerationMetrics() { clear(); }
+
+  /// Index of the generation, starting from zero.
+  uint64_t generation;
+
+  /// Wall time of the generation, in seconds.
+  double seconds;
+
+  /// Wall time spent in each phase, in seconds.
+  double phase_seconds[static_cast<int>(MetricsPhase::kCount)];
+
+  /// Number of events of each kind.
+  uint64_t counters[static_cast<int>(MetricsCounter::kCount)];
+
+  /// Number of evaluated individuals that the fitness statistics cover.
+  uint64_t fitness_count;
+
+  /// Best fitness.
+  double best_fitness;
+
+  /// Mean fitness.
+  double mean_fitness;
+
+  /// Standard deviation of the fitness.
+  double std_fitness;
+
+  double phase(MetricsPhase phase) const {
+    return phase_seconds[static_cast<int>(phase)];
+  }
+
+  uint64_t counter(MetricsCounter counter) const {
+    return counters[static_cast<int>(counter)];
+  }
+
+  /// Return the number of evaluations per second.
+  double throughput() const {
+    return seconds > 0.0 ? counter(MetricsCounter::kEvaluations) / seconds
+                         : 0.0;
+  }
+
+  void clear() {
+    generation = 0;
+    seconds = 0.0;
+    std::fill(phase_seconds, phase_seconds + kPhaseCount, 0.0);
+    std::fill(counters, counters + kCounterCount, 0);
+    fitness_count = 0;
+    best_fitness = 0.0;
+    mean_fitness = 0.0;
+    std_fitness = 0.0;
+  }
+
+  static constexpr int kPhaseCount = static_cast<int>(MetricsPhase::kCount);
+  static constexpr int kCounterCount =
+      static_cast<int>(MetricsCounter::kCount);
+};
+
+/// Sink that discards the metrics.
+struct MetricsSinkNone {
+  void operator()(const GenerationMetrics& metrics) {}
+};
+
+/// Sink that writes the metrics as CSV rows, preceded by a header row.
+struct MetricsSinkCsv {
+  explicit MetricsSinkCsv(std::ostream& out) : out(&out), header(false) {}
+
+  /// Output stream.
+  std::ostream* out;
+
+  /// Whether the header row has been written.
+  bool header;
+
+  void operator()(const GenerationMetrics& metrics) {
+    if (!header) {
+      *out << "generation,seconds";
+      for (int i = 0; i < GenerationMetrics::kPhaseCount; ++i) {
+        *out << ',' << MetricsPhaseName(static_cast<MetricsPhase>(i))
+             << "_seconds";
+      }
+
+      for (int i = 0; i < GenerationMetrics::kCounterCount; ++i) {
+        *out << ',' << MetricsCounterName(static_cast<MetricsCounter>(i));
+      }
+
+      *out << ",throughput,fitness_count,best_fitness,mean_fitness,"
+              "std_fitness\n";
+      header = true;
+    }
+
+    *out << metrics.generation << ',' << metrics.seconds;
+    for (double it : metrics.phase_seconds) {
+      *out << ',' << it;
+    }
+
+    for (uint64_t it : metrics.counters) {
+      *out << ',' << it;
+    }
+
+    *out << ',' << metrics.throughput() << ',' << metrics.fitness_count << ','
+         << metrics.best_fitness << ',' << metrics.mean_fitness << ','
+         << metrics.std_fitness << '\n';
+  }
+};
+
+/// Sink that writes the metrics as JSON objects, one per line.
+struct MetricsSinkJson {
+  explicit MetricsSinkJson(std::ostream& out) : out(&out) {}
+
+  /// Output stream.
+  std::ostream* out;
+
+  void operator()(const GenerationMetrics& metrics) {
+    *out << "{\"generation\":" << metrics.generation
+         << ",\"seconds\":" << metrics.seconds << ",\"phases\":{";
+    for (int i = 0; i < GenerationMetrics::kPhaseCount; ++i) {
+      *out << (i > 0 ? "," : "") << '"'
+           << MetricsPhaseName(static_cast<MetricsPhase>(i))
+           << "\":" << metrics.phase_seconds[i];
+    }
+
+    *out << "},\"counters\":{";
+    for (int i = 0; i < GenerationMetrics::kCounterCount; ++i) {
+      *out << (i > 0 ? "," : "") << '"'
+           << MetricsCounterName(static_cast<MetricsCounter>(i))
+           << "\":" << metrics.counters[i];
+    }
+
+    *out << "},\"throughput\":" << metrics.throughput()
+         << ",\"fitness\":{\"count\":" << metrics.fitness_count
+         << ",\"best\":" << metrics.best_fitness
+         << ",\"mean\":" << metrics.mean_fitness
+         << ",\"std\":" << metrics.std_fitness << "}}\n";
+  }
+};
+
+/// Observer that collects the metrics of every generation and passes them to
+/// a sink.
+///
+/// The wall time of a generation runs from the first phase after the end of
+/// the previous generation. The fitness statistics cover the evaluated
+/// individuals of every population observed during the generation, and are
+/// computed with `ComputeStats` when it ends. An observer must not be shared
+/// between threads.
+template <typename SinkFunc = MetricsSinkNone>
+struct Metrics {
+  explicit Metrics(const SinkFunc& sink = SinkFunc())
+      : sink(sink), generation_(0), running_(false) {}
+
+  /// Metrics sink.
+  SinkFunc sink;
+
+  /// Return the metrics of the last completed generation.
+  const GenerationMetrics& last() const { return last_; }
+
+  /// Return the metrics accumulated over all completed generations. The
+  /// fitness statistics are those of the last generation.
+  const GenerationMetrics& totals() const { return totals_; }
+
+  void Begin(MetricsPhase phase) {
+    Clock::time_point now = Clock::now();
+    if (!running_) {
+      start_ = now;
+      running_ = true;
+    }
+
+    phase_start_[static_cast<int>(phase)] = now;
+  }
+
+  void End(MetricsPhase phase) {
+    int index = static_cast<int>(phase);
+    current_.phase_seconds[index] +=
+        std::chrono::duration<double>(Clock::now() - phase_start_[index])
+            .count();
+  }
+
+  void Count(MetricsCounter counter, uint64_t count) {
+    current_.counters[static_cast<int>(counter)] += count;
+  }
+
+  template <typename Pop>
+  void Observe(const Pop& pop) {
+    for (const auto& it : pop) {
+      if (it.is_dirty()) {
+        continue;
+      }
+
+      fitness_.push_back(static_cast<double>(it.fitness));
+    }
+  }
+
+  void EndGeneration() {
+    current_.generation = generation_++;
+    if (running_) {
+      current_.seconds =
+          std::chrono::duration<double>(Clock::now() - start_).count();
+    }
+
+    current_.fitness_count = fitness_.size();
+    if (!fitness_.empty()) {
+      PopulationStats<double> stats =
+          ComputeStats(fitness_.data(), fitness_.size());
+      current_.best_fitness = stats.max;
+      current_.mean_fitness = stats.mean;
+      current_.std_fitness = stats.std_dev();
+    }
+
+    totals_.generation = current_.generation;
+    totals_.seconds += current_.seconds;
+    for (int i = 0; i < GenerationMetrics::kPhaseCount; ++i) {
+      totals_.phase_seconds[i] += current_.phase_seconds[i];
+    }
+
+    for (int i = 0; i < GenerationMetrics::kCounterCount; ++i) {
+      totals_.counters[i] += current_.counters[i];
+    }
+
+    totals_.fitness_count = current_.fitness_count;
+    totals_.best_fitness = current_.best_fitness;
+    totals_.mean_fitness = current_.mean_fitness;
+    totals_.std_fitness = current_.std_fitness;
+
+    last_ = current_;
+    sink(last_);
+    current_.clear();
+    fitness_.clear();
+    running_ = false;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  GenerationMetrics current_;
+  GenerationMetrics last_;
+  GenerationMetrics totals_;
+  Clock::time_point start_;
+  Clock::time_point phase_start_[GenerationMetrics::kPhaseCount];
+  uint64_t generation_;
+  bool running_;
+  std::vector<double> fitness_;
+};
+
+template <typename SinkFunc>
+Metrics<SinkFunc> make_metrics(SinkFunc sink) {
+  return Metrics<SinkFunc>(sink);
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_METRICS_H_
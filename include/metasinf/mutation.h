@@ -5,9 +5,15 @@
 #define METASINF_INCLUDE_METASINF_MUTATION_H_
 
 #include <algorithm>
+#include <cassert>
 #include <climits>
 #include <random>
 #include <utility>
+#include <vector>
+
+#include "metasinf/bit_genome.h"
+#include "metasinf/delta.h"
+#include "metasinf/random.h"
 
 namespace snf {
 
@@ -22,13 +28,74 @@ struct MutationFlip {
 
   template <typename T, typename Rng>
   void operator()(T& value, Rng& rng) {
+    MutationLogNone log;
+    Apply(value, log, rng);
+  }
+
+  template <typename T, typename Rng>
+  void operator()(T& value, MutationLog<typename T::value_type>& log,
+                  Rng& rng) {
+    Apply(value, log, rng);
+  }
+
+ private:
+  enum : size_t { kWordBits = BitGenome::kWordBits };
+
+  template <typename T, typename Log, typename Rng>
+  void Apply(T& value, Log& log, Rng& rng) {
     std::bernoulli_distribution dist(prob);
     for (size_t i = 0; i < value.size(); ++i) {
       if (dist(rng)) {
+        log.Record(i, value[i]);
         value[i] = !value[i];
       }
     }
   }
+
+  // Bit genomes are XORed with a random mask. Sparse masks are sampled as
+  // the positions of their bits, dense ones a word at a time.
+  template <typename Log, typename Rng>
+  void Apply(BitGenome& value, Log& log, Rng& rng) {
+    static constexpr double kDenseThreshold = 0.125;
+    thread_local std::vector<size_t> indices;
+    thread_local std::vector<uint64_t> mask;
+
+    if (prob < kDenseThreshold) {
+      indices.clear();
+      SampleBernoulli(prob, value.size(), indices, rng);
+      for (size_t i : indices) {
+        log.Record(i, value.test(i));
+        value.flip(i);
+      }
+
+      return;
+    }
+
+    mask.resize(value.word_count());
+    SampleBernoulliWords(prob, mask.data(), mask.size(), rng);
+    if (!mask.empty()) {
+      mask.back() &= value.tail_mask();
+    }
+
+    uint64_t* words = value.words();
+    for (size_t i = 0; i < mask.size(); ++i) {
+      RecordWord(log, i, words[i], mask[i]);
+      words[i] ^= mask[i];
+    }
+  }
+
+  static void RecordWord(MutationLogNone& log, size_t index, uint64_t word,
+                         uint64_t mask) {}
+
+  template <typename Log>
+  static void RecordWord(Log& log, size_t index, uint64_t word,
+                         uint64_t mask) {
+    for (size_t bit = 0; mask != 0; ++bit, mask >>= 1) {
+      if (mask & 1) {
+        log.Record(index * kWordBits + bit, (word >> bit & 1) != 0);
+      }
+    }
+  }
 };
 
 /// Swap mutation.
@@ -42,6 +109,19 @@ struct MutationSwap {
 
   template <typename T, typename Rng>
   void operator()(T& value, Rng& rng) {
+    MutationLogNone log;
+    Apply(value, log, rng);
+  }
+
+  template <typename T, typename Rng>
+  void operator()(T& value, MutationLog<typename T::value_type>& log,
+                  Rng& rng) {
+    Apply(value, log, rng);
+  }
+
+ private:
+  template <typename T, typename Log, typename Rng>
+  void Apply(T& value, Log& log, Rng& rng) {
     assert(value.size() > 1);
     std::uniform_int_distribution<size_t> dist(0, value.size() - 1);
     for (int i = 0; i < count; ++i) {
@@ -50,6 +130,8 @@ struct MutationSwap {
       do {
         index1 = dist(rng);
       } while (index0 == index1);
+      log.Record(index0, value[index0]);
+      log.Record(index1, value[index1]);
       std::swap(value[index0], value[index1]);
     }
   }
@@ -61,6 +143,19 @@ struct MutationSwap {
 struct MutationInvert {
   template <typename T, typename Rng>
   void operator()(T& value, Rng& rng) {
+    MutationLogNone log;
+    Apply(value, log, rng);
+  }
+
+  template <typename T, typename Rng>
+  void operator()(T& value, MutationLog<typename T::value_type>& log,
+                  Rng& rng) {
+    Apply(value, log, rng);
+  }
+
+ private:
+  template <typename T, typename Log, typename Rng>
+  void Apply(T& value, Log& log, Rng& rng) {
     assert(value.size() > 1);
     std::uniform_int_distribution<size_t> dist(0, value.size());
     size_t index0 = dist(rng);
@@ -73,6 +168,10 @@ struct MutationInvert {
       std::swap(index0, index1);
     }
 
+    for (size_t i = index0; i < index1; ++i) {
+      log.Record(i, value[i]);
+    }
+
     std::reverse(value.begin() + index0, value.begin() + index1);
   }
 };
@@ -83,6 +182,19 @@ struct MutationInvert {
 struct MutationMove {
   template <typename T, typename Rng>
   void operator()(T& value, Rng& rng) {
+    MutationLogNone log;
+    Apply(value, log, rng);
+  }
+
+  template <typename T, typename Rng>
+  void operator()(T& value, MutationLog<typename T::value_type>& log,
+                  Rng& rng) {
+    Apply(value, log, rng);
+  }
+
+ private:
+  template <typename T, typename Log, typename Rng>
+  void Apply(T& value, Log& log, Rng& rng) {
     assert(value.size() > 1);
     std::uniform_int_distribution<size_t> dist(0, value.size() - 1);
     size_t index0 = dist(rng);
@@ -95,6 +207,10 @@ struct MutationMove {
       std::swap(index0, index1);
     }
 
+    for (size_t i = index0; i <= index1; ++i) {
+      log.Record(i, value[i]);
+    }
+
     auto tmp = value[index1];
     for (size_t i = index1; i > index0; --i) {
       value[i] = value[i - 1];
@@ -191,10 +307,24 @@ struct MutationVector {
 
   template <typename T, typename Rng>
   void operator()(T& value, Rng& rng) {
+    MutationLogNone log;
+    Apply(value, log, rng);
+  }
+
+  template <typename T, typename Rng>
+  void operator()(T& value, MutationLog<typename T::value_type>& log,
+                  Rng& rng) {
+    Apply(value, log, rng);
+  }
+
+ private:
+  template <typename T, typename Log, typename Rng>
+  void Apply(T& value, Log& log, Rng& rng) {
     std::bernoulli_distribution dist(prob);
-    for (auto& it : value) {
+    for (size_t i = 0; i < value.size(); ++i) {
       if (dist(rng)) {
-        func(it, rng);
+        log.Record(i, value[i]);
+        func(value[i], rng);
       }
     }
   }
@@ -0,0 +1,480 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_NSGA2_H_
+#define METASINF_INCLUDE_METASINF_NSGA2_H_
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snf {
+
+/// Encapsulates an individual and its objective values.
+///
+/// All the objectives are maximized. The individual is dirty while it has no
+/// objective values.
+template <typename T, typename F = double>
+struct MultiIndividual {
+  MultiIndividual() : rank(0), crowding(0.0) {}
+  explicit MultiIndividual(const T& data)
+      : data(data), rank(0), crowding(0.0) {}
+
+  /// Data value.
+  T data;
+
+  /// Objective values.
+  std::vector<F> objectives;
+
+  /// Index of the non-dominated front of the individual, starting from zero.
+  size_t rank;
+
+  /// Crowding distance of the individual within its front.
+  F crowding;
+
+  /// Return whether the individual is dirty, i.e. whether its objectives need
+  /// to be recomputed.
+  bool is_dirty() const { return objectives.empty(); }
+
+  /// Mark the individual as dirty.
+  void mark_dirty() { objectives.clear(); }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(data);
+    writer.Write(objectives);
+    writer.Write(static_cast<uint64_t>(rank));
+    writer.Write(crowding);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    uint64_t value = 0;
+    reader.Read(data);
+    reader.Read(objectives);
+    reader.Read(value);
+    reader.Read(crowding);
+    rank = static_cast<size_t>(value);
+  }
+};
+
+/// Population of individuals with multiple objectives.
+template <typename T, typename F = double>
+using MultiPopulation = std::vector<MultiIndividual<T, F>>;
+
+/// Return whether the objective values `lhs` dominate `rhs`, i.e. whether
+/// they are no worse in every objective and better in at least one.
+template <typename F>
+bool Dominates(const std::vector<F>& lhs, const std::vector<F>& rhs) {
+  assert(lhs.size() == rhs.size());
+  bool better = false;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (lhs[i] < rhs[i]) {
+      return false;
+    }
+
+    better = better || lhs[i] > rhs[i];
+  }
+
+  return better;
+}
+
+/// Compute the objective values of the dirty individuals.
+///
+/// The evaluation functor is called as `func(data, objectives, rng)` and
+/// writes the objective values to `objectives`, which it receives empty.
+/// Returns the number of evaluated individuals.
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+size_t Evaluate(MultiPopulation<T, F>& pop, EvaluationFunc& func, Rng& rng) {
+  size_t count = 0;
+  for (auto& it : pop) {
+    if (it.is_dirty()) {
+      func(it.data, it.objectives, rng);
+      assert(!it.objectives.empty());
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+/// Sort the individuals into non-dominated fronts.
+///
+/// Sets the rank of every individual and stores the indices of the
+/// individuals of each front in `fronts`, best front first. Uses efficient
+/// non-dominated sorting with binary search (ENS-BS): the individuals are
+/// visited in lexicographic order, so none can dominate one visited before
+/// it, and each one is inserted into the first front that does not dominate
+/// it, which is found by a binary search over the fronts.
+///
+/// Whether a front dominates an individual is answered in O(log N) time for
+/// two and three objectives, so the sort takes O(N log^2 N) time. With two
+/// objectives a front dominates an individual exactly when its last member
+/// does. With three, every front keeps the staircase of its members that
+/// are maximal in the last two objectives. More objectives fall back to
+/// scanning the front.
+template <typename Pop>
+void SortNonDominated(Pop& pop, std::vector<std::vector<size_t>>& fronts) {
+  using F = typename std::decay<decltype(pop[0].objectives[0])>::type;
+  // Points of a staircase by second objective, with their third and first
+  // objectives.
+  using Staircase = std::map<F, std::pair<F, F>>;
+  thread_local std::vector<size_t> order;
+  thread_local std::vector<Staircase> staircases;
+
+  for (auto& it : fronts) {
+    it.clear();
+  }
+
+  order.resize(pop.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+
+  std::sort(order.begin(), order.end(), [&pop](size_t lhs, size_t rhs) {
+    return pop[lhs].objectives > pop[rhs].objectives;
+  });
+
+  size_t front_count = 0;
+  for (size_t index : order) {
+    const auto& objectives = pop[index].objectives;
+    auto dominated = [&](size_t front) {
+      if (objectives.size() == 2) {
+        return Dominates(pop[fronts[front].back()].objectives, objectives);
+      }
+
+      if (objectives.size() == 3) {
+        // The first point at or above the second objective has the
+        // largest third objective among them. Members were visited
+        // earlier, so they are no worse in the first objective.
+        const Staircase& staircase = staircases[front];
+        auto it = staircase.lower_bound(objectives[1]);
+        if (it == staircase.end() || it->second.first < objectives[2]) {
+          return false;
+        }
+
+        return it->first > objectives[1] ||
+               it->second.first > objectives[2] ||
+               it->second.second > objectives[0];
+      }
+
+      for (auto it = fronts[front].rbegin(); it != fronts[front].rend();
+           ++it) {
+        if (Dominates(pop[*it].objectives, objectives)) {
+          return true;
+        }
+      }
+
+      return false;
+    };
+
+    size_t lower = 0;
+    size_t upper = front_count;
+    while (lower < upper) {
+      size_t middle = lower + (upper - lower) / 2;
+      if (dominated(middle)) {
+        lower = middle + 1;
+      } else {
+        upper = middle;
+      }
+    }
+
+    if (lower == front_count) {
+      ++front_count;
+      if (fronts.size() < front_count) {
+        fronts.emplace_back();
+      }
+
+      if (staircases.size() < front_count) {
+        staircases.emplace_back();
+      }
+
+      staircases[lower].clear();
+    }
+
+    fronts[lower].push_back(index);
+    pop[index].rank = lower;
+
+    if (objectives.size() == 3) {
+      // Insert the point unless it is covered, and drop the points that it
+      // covers. A covered point keeps the larger first objective.
+      Staircase& staircase = staircases[lower];
+      auto it = staircase.lower_bound(objectives[1]);
+      if (it != staircase.end() && it->second.first >= objectives[2]) {
+        continue;
+      }
+
+      if (it != staircase.end() && it->first == objectives[1]) {
+        it = staircase.erase(it);
+      }
+
+      while (it != staircase.begin() &&
+             std::prev(it)->second.first <= objectives[2]) {
+        staircase.erase(std::prev(it));
+      }
+
+      staircase.emplace_hint(
+          it, objectives[1], std::make_pair(objectives[2], objectives[0]));
+    }
+  }
+
+  fronts.resize(front_count);
+}
+
+/// Compute the crowding distance of the individuals of a front.
+///
+/// The distance of an individual is the sum over the objectives of the
+/// normalized distance between its neighbors in the front. The extreme
+/// individuals of every objective get an infinite distance. Takes
+/// O(M N log N) time for M objectives.
+template <typename Pop>
+void AssignCrowding(Pop& pop, const std::vector<size_t>& front) {
+  using F = typename std::decay<decltype(pop[0].crowding)>::type;
+  thread_local std::vector<size_t> order;
+
+  for (size_t index : front) {
+    pop[index].crowding = 0.0;
+  }
+
+  if (front.empty()) {
+    return;
+  }
+
+  order.assign(front.begin(), front.end());
+  size_t objective_count = pop[front[0]].objectives.size();
+  for (size_t m = 0; m < objective_count; ++m) {
+    std::sort(order.begin(), order.end(), [&pop, m](size_t lhs, size_t rhs) {
+      return pop[lhs].objectives[m] < pop[rhs].objectives[m];
+    });
+
+    F min = pop[order.front()].objectives[m];
+    F max = pop[order.back()].objectives[m];
+    pop[order.front()].crowding = std::numeric_limits<F>::infinity();
+    pop[order.back()].crowding = std::numeric_limits<F>::infinity();
+    if (max <= min) {
+      continue;
+    }
+
+    for (size_t i = 1; i + 1 < order.size(); ++i) {
+      pop[order[i]].crowding += (pop[order[i + 1]].objectives[m] -
+                                 pop[order[i - 1]].objectives[m]) /
+                                (max - min);
+    }
+  }
+}
+
+/// Return whether `lhs` is preferred to `rhs` by the crowded comparison,
+/// i.e. whether it belongs to a better front, or to the same front in a less
+/// crowded region.
+template <typename Ind>
+bool CrowdedBetter(const Ind& lhs, const Ind& rhs) {
+  return lhs.rank < rhs.rank ||
+         (lhs.rank == rhs.rank && lhs.crowding > rhs.crowding);
+}
+
+/// Keep only the individuals at the positions in `survivors`, which is
+/// sorted in the process.
+template <typename Pop>
+void KeepSurvivors(Pop& pop, std::vector<size_t>& survivors) {
+  std::sort(survivors.begin(), survivors.end());
+  for (size_t i = 0; i < survivors.size(); ++i) {
+    if (survivors[i] != i) {
+      std::swap(pop[i], pop[survivors[i]]);
+    }
+  }
+
+  pop.resize(survivors.size());
+}
+
+/// Replace the individuals by the best fronts of the population and the
+/// offspring, as in NSGA-II.
+///
+/// The offspring join the population, which is then sorted into
+/// non-dominated fronts. The best fronts survive whole, and the first front
+/// that does not fit is truncated to its least crowded individuals. Sets
+/// the rank and the crowding distance of the survivors. All individuals
+/// must have been evaluated.
+struct ReplacementCrowding {
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<std::vector<size_t>> fronts;
+    thread_local std::vector<size_t> survivors;
+
+    size_t size = dst.empty() ? src.size() : dst.size();
+    dst.reserve(dst.size() + src.size());
+    std::move(src.begin(), src.end(), std::back_inserter(dst));
+    src.clear();
+
+    SortNonDominated(dst, fronts);
+    survivors.clear();
+    for (const auto& front : fronts) {
+      AssignCrowding(dst, front);
+      if (survivors.size() + front.size() <= size) {
+        survivors.insert(survivors.end(), front.begin(), front.end());
+        continue;
+      }
+
+      size_t first = survivors.size();
+      survivors.insert(survivors.end(), front.begin(), front.end());
+      std::nth_element(survivors.begin() + first,
+                       survivors.begin() + (size - 1), survivors.end(),
+                       [&dst](size_t lhs, size_t rhs) {
+                         return dst[lhs].crowding > dst[rhs].crowding;
+                       });
+      survivors.resize(size);
+      break;
+    }
+
+    KeepSurvivors(dst, survivors);
+  }
+};
+
+/// Non-dominated sorting genetic algorithm II.
+///
+/// Parents are chosen by binary tournaments with the crowded comparison and
+/// bred in pairs with the crossover and mutation functors. The replacement
+/// functor then merges the offspring into the population and restores its
+/// size; it must set the rank and the crowding distance of the survivors,
+/// which the next tournaments compare. The default keeps the best fronts
+/// and truncates the last by crowding distance; `ReplacementHypervolume`
+/// turns the algorithm into SMS-EMOA. The population must be a
+/// `MultiPopulation`.
+template <
+    typename EvaluationFunc,
+    typename CrossoverFunc,
+    typename MutationFunc,
+    typename TerminationFunc,
+    typename ReplacementFunc = ReplacementCrowding>
+struct Nsga2 {
+  /// Construct a new simulation.
+  Nsga2(double mutation_rate, double crossover_rate,
+        const EvaluationFunc& evaluation = EvaluationFunc(),
+        const CrossoverFunc& crossover = CrossoverFunc(),
+        const MutationFunc& mutation = MutationFunc(),
+        const TerminationFunc& termination = TerminationFunc(),
+        const ReplacementFunc& replacement = ReplacementFunc())
+      : mutation_rate(mutation_rate),
+        crossover_rate(crossover_rate),
+        evaluation(evaluation),
+        crossover(crossover),
+        mutation(mutation),
+        termination(termination),
+        replacement(replacement) {}
+
+  /// Mutation rate.
+  double mutation_rate;
+
+  /// Crossover rate.
+  double crossover_rate;
+
+  /// Evaluation functor.
+  EvaluationFunc evaluation;
+
+  /// Crossover functor.
+  CrossoverFunc crossover;
+
+  /// Mutation functor.
+  MutationFunc mutation;
+
+  /// Termination functor.
+  TerminationFunc termination;
+
+  /// Replacement functor.
+  ReplacementFunc replacement;
+
+  /// Perform the next evolution step.
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
+    thread_local Pop children;
+    thread_local std::vector<std::vector<size_t>> fronts;
+
+    assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
+    assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
+    if (pop.empty()) {
+      return true;
+    }
+
+    // The ranks of the survivors of the previous step remain valid unless
+    // the population has changed since.
+    if (Evaluate(pop, evaluation, rng) > 0) {
+      SortNonDominated(pop, fronts);
+      for (const auto& front : fronts) {
+        AssignCrowding(pop, front);
+      }
+    }
+
+    size_t size = pop.size();
+    children.resize(size + size % 2);
+    std::uniform_int_distribution<size_t> index_dist(0, size - 1);
+    for (auto& child : children) {
+      size_t index0 = index_dist(rng);
+      size_t index1 = index_dist(rng);
+      child = pop[CrowdedBetter(pop[index1], pop[index0]) ? index1 : index0];
+    }
+
+    std::bernoulli_distribution mutation_dist(mutation_rate);
+    std::bernoulli_distribution crossover_dist(crossover_rate);
+    for (size_t i = 0; i < children.size(); i += 2) {
+      auto& child0 = children[i + 0];
+      auto& child1 = children[i + 1];
+
+      if (crossover_dist(rng)) {
+        crossover(child0.data, child1.data, rng);
+        child0.mark_dirty();
+        child1.mark_dirty();
+      }
+
+      if (mutation_dist(rng)) {
+        mutation(child0.data, rng);
+        child0.mark_dirty();
+      }
+
+      if (mutation_dist(rng)) {
+        mutation(child1.data, rng);
+        child1.mark_dirty();
+      }
+    }
+
+    children.resize(size);
+    Evaluate(children, evaluation, rng);
+    replacement(children, pop, rng);
+    return termination(pop, rng);
+  }
+
+  /// Run the algorithm until the termination conditions have been met.
+  template <typename Pop, typename Rng>
+  void Run(Pop& pop, Rng& rng) {
+    while (!operator()(pop, rng)) {}
+  }
+
+  /// Write the rates and the termination state to a checkpoint.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(mutation_rate);
+    writer.Write(crossover_rate);
+    writer.Write(termination);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(mutation_rate);
+    reader.Read(crossover_rate);
+    reader.Read(termination);
+  }
+};
+
+template <typename... Args>
+Nsga2<Args...> make_nsga2(double mutation_rate, double crossover_rate,
+                          Args... args) {
+  return {mutation_rate, crossover_rate, args...};
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_NSGA2_H_
@@ -0,0 +1,314 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_PARALLEL_H_
+#define METASINF_INCLUDE_METASINF_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/population.h"
+
+namespace snf {
+
+/// Check whether a random number generator can derive substreams.
+///
+/// Such generators, like `Philox4x32`, provide `rng.Substream(id)`, which
+/// returns an independent generator in constant time.
+template <typename Rng>
+struct HasSubstream {
+  template <typename U>
+  static auto Test(U* rng) -> decltype(
+      rng->Substream(std::declval<uint64_t>()), std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<Rng*>(nullptr)))::value;
+};
+
+template <typename Rng>
+Rng ForkRng(Rng& rng, std::true_type) {
+  uint64_t id = rng();
+  id = (id << 32) ^ rng();
+  return rng.Substream(id);
+}
+
+template <typename Rng>
+Rng ForkRng(Rng& rng, std::false_type) {
+  std::seed_seq seq{rng(), rng(), rng(), rng()};
+  return Rng(seq);
+}
+
+/// Derive an independent random number generator from the specified one.
+template <typename Rng>
+Rng ForkRng(Rng& rng) {
+  return ForkRng(rng, std::integral_constant<bool,
+                                             HasSubstream<Rng>::value>());
+}
+
+template <typename Rng>
+Rng StreamRng(uint64_t key, uint64_t index, std::true_type) {
+  return Rng(key).Substream(index);
+}
+
+template <typename Rng>
+Rng StreamRng(uint64_t key, uint64_t index, std::false_type) {
+  std::seed_seq seq{static_cast<uint32_t>(key),
+                    static_cast<uint32_t>(key >> 32),
+                    static_cast<uint32_t>(index),
+                    static_cast<uint32_t>(index >> 32)};
+  return Rng(seq);
+}
+
+/// Derive the random number generator of a task from a key and the index of
+/// the task.
+///
+/// The generator depends only on its arguments, so tasks can be scheduled on
+/// any number of threads and still draw the same random numbers. Generators
+/// with substreams are derived in constant time.
+template <typename Rng>
+Rng StreamRng(uint64_t key, uint64_t index) {
+  return StreamRng<Rng>(key, index, std::integral_constant<bool,
+                                        HasSubstream<Rng>::value>());
+}
+
+/// Check whether a selection functor can plan in parallel.
+///
+/// Such a functor provides `func.Plan(src, indices, rng, executor)`, which
+/// appends to `indices` like the serial selection plan.
+template <typename SelectionFunc, typename Pop, typename Rng,
+          typename Executor>
+struct HasParallelPlan {
+  template <typename U>
+  static auto Test(U* func) -> decltype(
+      func->Plan(std::declval<const Pop&>(),
+                 std::declval<std::vector<size_t>&>(), std::declval<Rng&>(),
+                 std::declval<Executor&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<SelectionFunc*>(nullptr)))::value;
+};
+
+template <typename SelectionFunc, typename Pop, typename Rng,
+          typename Executor>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng,
+                    Executor& executor, std::true_type) {
+  thread_local std::vector<size_t> plan;
+
+  plan.clear();
+  selection.Plan(src, plan, rng, executor);
+  std::shuffle(plan.begin(), plan.end(), rng);
+  Gather(src, plan, dst);
+}
+
+template <typename SelectionFunc, typename Pop, typename Rng,
+          typename Executor>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng,
+                    Executor& executor, std::false_type) {
+  SelectShuffled(selection, src, dst, rng);
+}
+
+/// Select individuals from `src` and append them to `dst` in random order,
+/// planning the selection with the specified executor if the selection
+/// functor supports it.
+template <typename SelectionFunc, typename Pop, typename Rng,
+          typename Executor>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng,
+                    Executor& executor) {
+  SelectShuffled(selection, src, dst, rng, executor,
+                 std::integral_constant<bool, HasParallelPlan<
+                     SelectionFunc, Pop, Rng, Executor>::value>());
+}
+
+/// Executor that runs every task on the calling thread.
+///
+/// An executor exposes its number of workers through `concurrency()` and
+/// invokes `func(worker)` once for every worker index in
+/// [0, concurrency()), returning only when all invocations have completed.
+struct SerialExecutor {
+  size_t concurrency() const { return 1; }
+
+  template <typename Func>
+  void operator()(Func func) {
+    func(0);
+  }
+};
+
+/// Executor backed by a fixed set of persistent threads.
+///
+/// The calling thread acts as worker 0. Calls made from within a running
+/// task are executed serially on the calling thread, so nested parallel
+/// sections do not deadlock.
+struct ThreadPool {
+  explicit ThreadPool(
+      size_t thread_count = std::thread::hardware_concurrency())
+      : generation_(0), pending_(0), stop_(false) {
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads_.emplace_back(&ThreadPool::Work, this, i);
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+
+    start_cv_.notify_all();
+    for (auto& it : threads_) {
+      it.join();
+    }
+  }
+
+  size_t concurrency() const { return threads_.size() + 1; }
+
+  template <typename Func>
+  void operator()(Func func) {
+    if (threads_.empty() || InPool()) {
+      for (size_t i = 0; i < concurrency(); ++i) {
+        func(i);
+      }
+
+      return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = func;
+      pending_ = threads_.size();
+      ++generation_;
+    }
+
+    start_cv_.notify_all();
+    InPool() = true;
+    func(0);
+    InPool() = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+  }
+
+ private:
+  static bool& InPool() {
+    thread_local bool in_pool = false;
+    return in_pool;
+  }
+
+  void Work(size_t worker) {
+    InPool() = true;
+    uint64_t generation = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [this, generation] {
+          return stop_ || generation_ != generation;
+        });
+
+        if (stop_) {
+          return;
+        }
+
+        generation = generation_;
+      }
+
+      task_(worker);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex call_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  std::function<void(size_t)> task_;
+  uint64_t generation_;
+  size_t pending_;
+  bool stop_;
+};
+
+/// Evaluate individuals concurrently using the specified executor.
+///
+/// The wrapped evaluation functor is invoked from multiple threads and must
+/// be thread-safe. Genomes are handed out in chunks of `chunk_size`, so
+/// workers that finish early pick up the remaining load. If the wrapped
+/// functor is a batch evaluator, it receives one chunk per call.
+///
+/// Every chunk draws its random numbers from its own stream, derived with
+/// `StreamRng` from a key drawn from the generator passed to the evaluator
+/// and from the index of the chunk. The fitness values and the state of
+/// that generator therefore do not depend on the number of workers.
+template <typename EvaluationFunc, typename Executor = ThreadPool>
+struct EvaluationParallel {
+  explicit EvaluationParallel(Executor& executor,
+                              const EvaluationFunc& func = EvaluationFunc(),
+                              size_t chunk_size = 1)
+      : executor(&executor), func(func), chunk_size(chunk_size) {}
+
+  /// Executor used to run the evaluations.
+  Executor* executor;
+
+  /// Wrapped evaluation functor.
+  EvaluationFunc func;
+
+  /// Number of genomes handed to a worker at a time.
+  size_t chunk_size;
+
+  template <typename T, typename Rng>
+  auto operator()(T& data, Rng& rng) -> decltype(func(data, rng)) {
+    return func(data, rng);
+  }
+
+  template <typename T, typename F, typename Rng>
+  void operator()(Span<T> data, Span<F> fitness, Rng& rng) {
+    assert(chunk_size > 0);
+    size_t chunk_count = (data.size() + chunk_size - 1) / chunk_size;
+    uint64_t key = rng();
+    key = (key << 32) ^ rng();
+
+    std::atomic<size_t> next(0);
+    (*executor)([&](size_t worker) {
+      for (size_t i = next++; i < chunk_count; i = next++) {
+        Rng stream = StreamRng<Rng>(key, i);
+        size_t offset = i * chunk_size;
+        size_t count = std::min(chunk_size, data.size() - offset);
+        EvaluateBatch(data.subspan(offset, count),
+                      fitness.subspan(offset, count), func, stream);
+      }
+    });
+  }
+};
+
+template <typename Executor, typename EvaluationFunc>
+EvaluationParallel<EvaluationFunc, Executor> make_evaluation_parallel(
+    Executor& executor, EvaluationFunc func, size_t chunk_size = 1) {
+  return EvaluationParallel<EvaluationFunc, Executor>(executor, func,
+                                                       chunk_size);
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_PARALLEL_H_
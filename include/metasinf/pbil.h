@@ -6,6 +6,7 @@
 
 #include <array>
 #include <random>
+#include <vector>
 
 #include "metasinf/population.h"
 
@@ -66,13 +67,17 @@ struct PbilUpdate {
                   Rng& rng) {
     assert(best_count > 0 && best_count <= pop.size());
 
+    thread_local std::vector<size_t> best;
+
+    best.clear();
+    FittestIndices(pop, best_count, best);
+
     std::bernoulli_distribution flip_dist, mutation_dist(mutation_prob);
-    std::sort(pop.begin(), pop.end(), std::greater<Individual<T, F>>());
     for (size_t i = 0; i < Size; ++i) {
       ProbT p = dist.prob[i] * (1.0 - rate);
       ProbT lr = rate / best_count;
       for (size_t j = 0; j < best_count; ++j) {
-        if (pop[j].data[i]) {
+        if (pop[best[j]].data[i]) {
           p += lr;
         }
       }
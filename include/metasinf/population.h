@@ -9,6 +9,8 @@
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 
 namespace snf {
 
@@ -62,15 +64,360 @@ struct Individual {
 template <typename T, typename F>
 using Population = std::vector<Individual<T, F>>;
 
-/// Compute the fitness of the individuals.
+/// Fitness type of the individuals of a population.
+template <typename Pop>
+using FitnessType = typename std::decay<
+    decltype(std::declval<Pop&>()[0].fitness)>::type;
+
+/// Fitness of an individual, without its genome.
+template <typename F>
+struct FitnessEntry {
+  /// Fitness value.
+  F fitness;
+
+  bool operator<(const FitnessEntry& rhs) const {
+    return fitness < rhs.fitness;
+  }
+
+  bool operator>(const FitnessEntry& rhs) const {
+    return fitness > rhs.fitness;
+  }
+};
+
+/// Fitness values indexed like the individuals of a population.
+///
+/// A view stands in for the population wherever only the fitness is read,
+/// e.g. by selection plans, whose indices then refer to the population. This
+/// way a selection can run on transformed fitness values without copying
+/// any genome.
+template <typename F>
+using FitnessView = std::vector<FitnessEntry<F>>;
+
+/// Return the fitness of the individuals of `pop` as a contiguous array.
+///
+/// The fitness values are copied to `buffer`, unless the population already
+/// stores them contiguously.
+template <typename Pop>
+const FitnessType<Pop>* FitnessArray(const Pop& pop,
+                                     std::vector<FitnessType<Pop>>& buffer) {
+  buffer.resize(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    buffer[i] = pop[i].fitness;
+  }
+
+  return buffer.data();
+}
+
+/// Copy the fitness of the individuals of `pop` to `view`.
+template <typename Pop>
+void ViewFitness(const Pop& pop, FitnessView<FitnessType<Pop>>& view) {
+  view.resize(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    view[i].fitness = pop[i].fitness;
+  }
+}
+
+/// Append the individuals at the specified indices of `src` to `dst`.
+template <typename Pop>
+void Gather(const Pop& src, const std::vector<size_t>& indices, Pop& dst) {
+  dst.reserve(dst.size() + indices.size());
+  for (size_t index : indices) {
+    dst.push_back(src[index]);
+  }
+}
+
+/// Move the individual at `src_index` of `src` over the individual at
+/// `dst_index` of `dst`.
+template <typename T, typename F>
+void MoveIndividual(Population<T, F>& src, size_t src_index,
+                    Population<T, F>& dst, size_t dst_index) {
+  dst[dst_index] = std::move(src[src_index]);
+}
+
+/// Overwrite the individual at `dst_index` of `dst` with a copy of the
+/// individual at `src_index` of `src`, reusing the storage of the former.
+template <typename T, typename F>
+void CopyIndividual(const Population<T, F>& src, size_t src_index,
+                    Population<T, F>& dst, size_t dst_index) {
+  dst[dst_index] = src[src_index];
+}
+
+/// Exchange an individual of `pop0` with an individual of `pop1`.
+template <typename T, typename F>
+void SwapIndividuals(Population<T, F>& pop0, size_t index0,
+                     Population<T, F>& pop1, size_t index1) {
+  using std::swap;
+  swap(pop0[index0], pop1[index1]);
+}
+
+/// Resize `dst` to `size` individuals with the same genome layout as `src`.
+template <typename T, typename F>
+void ResizeLike(Population<T, F>& dst, const Population<T, F>& src,
+                size_t size) {
+  dst.resize(size);
+}
+
+/// Check whether a selection functor can output a selection plan.
+///
+/// A selection plan lists the indices of the selected individuals instead of
+/// copying them. It is produced by `func.Plan(src, indices, rng)`, which
+/// appends to `indices`.
+template <typename SelectionFunc, typename Pop, typename Rng>
+struct HasSelectionPlan {
+  template <typename U>
+  static auto Test(U* func) -> decltype(
+      func->Plan(std::declval<const Pop&>(),
+                 std::declval<std::vector<size_t>&>(), std::declval<Rng&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<SelectionFunc*>(nullptr)))::value;
+};
+
+/// Check whether a selection functor can draw single parents.
+///
+/// Such a functor provides `Draw(src, rng)`, which returns the index of one
+/// selected individual at a cost that does not depend on the population
+/// size, without planning a whole selection.
+template <typename SelectionFunc, typename Pop, typename Rng>
+struct HasSelectionDraw {
+  template <typename U>
+  static auto Test(U* func) -> decltype(
+      static_cast<size_t>(
+          func->Draw(std::declval<const Pop&>(), std::declval<Rng&>())),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<SelectionFunc*>(nullptr)))::value;
+};
+
+/// Shuffle the individuals.
+template <typename T, typename F, typename Rng>
+void Shuffle(Population<T, F>& pop, Rng& rng) {
+  std::shuffle(pop.begin(), pop.end(), rng);
+}
+
+template <typename SelectionFunc, typename Pop, typename Rng>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng,
+                    std::true_type) {
+  thread_local std::vector<size_t> plan;
+
+  plan.clear();
+  selection.Plan(src, plan, rng);
+  std::shuffle(plan.begin(), plan.end(), rng);
+  Gather(src, plan, dst);
+}
+
+template <typename SelectionFunc, typename Pop, typename Rng>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng,
+                    std::false_type) {
+  thread_local Pop tmp;
+
+  tmp.clear();
+  selection(src, tmp, rng);
+  Shuffle(tmp, rng);
+  dst.reserve(dst.size() + tmp.size());
+  for (size_t i = 0; i < tmp.size(); ++i) {
+    dst.push_back(std::move(tmp[i]));
+  }
+}
+
+/// Select individuals from `src` and append them to `dst` in random order.
+///
+/// With a selection plan only the indices are shuffled, and every selected
+/// individual is copied straight from `src` exactly once.
+template <typename SelectionFunc, typename Pop, typename Rng>
+void SelectShuffled(SelectionFunc& selection, Pop& src, Pop& dst, Rng& rng) {
+  SelectShuffled(selection, src, dst, rng,
+                 std::integral_constant<bool, HasSelectionPlan<
+                     SelectionFunc, Pop, Rng>::value>());
+}
+
+/// Sort the individuals by descending fitness.
+template <typename T, typename F>
+void SortByFitness(Population<T, F>& pop) {
+  std::sort(pop.begin(), pop.end(), std::greater<Individual<T, F>>());
+}
+
+/// Append the indices of the `count` fittest individuals of `pop` to `dst`,
+/// in descending order of fitness.
+///
+/// Only the indices are ordered, and only the selected ones are sorted, so
+/// this takes O(n + count log count) time and never moves a genome. Ties go
+/// to the higher index: engines append offspring after their parents, so an
+/// offspring displaces an equally fit parent and the population keeps
+/// drifting across fitness plateaus.
+template <typename Pop>
+void FittestIndices(const Pop& pop, size_t count, std::vector<size_t>& dst) {
+  using F = FitnessType<Pop>;
+  thread_local std::vector<F> fitness;
+
+  count = std::min(count, pop.size());
+  fitness.resize(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    fitness[i] = pop[i].fitness;
+  }
+
+  auto fitter = [](size_t lhs, size_t rhs) {
+    return fitness[lhs] > fitness[rhs] ||
+           (fitness[lhs] == fitness[rhs] && lhs > rhs);
+  };
+
+  size_t offset = dst.size();
+  for (size_t i = 0; i < pop.size(); ++i) {
+    dst.push_back(i);
+  }
+
+  auto first = dst.begin() + offset;
+  std::nth_element(first, first + count, dst.end(), fitter);
+  dst.resize(offset + count);
+  std::sort(dst.begin() + offset, dst.end(), fitter);
+}
+
+/// Non-owning view over a contiguous sequence of objects.
+template <typename T>
+struct Span {
+  using value_type = typename std::remove_cv<T>::type;
+  using iterator = T*;
+
+  Span() : data_(nullptr), size_(0) {}
+  Span(T* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename U, typename = typename std::enable_if<
+                            std::is_convertible<U*, T*>::value>::type>
+  Span(const Span<U>& other) : data_(other.data()), size_(other.size()) {}
+
+  T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+
+  T& operator[](size_t index) const {
+    assert(index < size_);
+    return data_[index];
+  }
+
+  /// Return a view over `count` objects starting at `offset`.
+  Span subspan(size_t offset, size_t count) const {
+    assert(offset + count <= size_);
+    return Span(data_ + offset, count);
+  }
+
+ private:
+  T* data_;
+  size_t size_;
+};
+
+/// Check whether an evaluation functor accepts a whole batch of genomes.
+///
+/// A batch evaluator is called as `func(data, fitness, rng)`, where `data`
+/// is a `Span<T>` of genomes and `fitness` a `Span<F>` of equal size that
+/// receives their fitness values.
+template <typename EvaluationFunc, typename T, typename F, typename Rng>
+struct IsBatchEvaluator {
+  template <typename U>
+  static auto Test(U* func) -> decltype(
+      (*func)(std::declval<Span<T>>(), std::declval<Span<F>>(),
+              std::declval<Rng&>()),
+      std::true_type());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<EvaluationFunc*>(nullptr)))::value;
+};
+
 template <typename T, typename F, typename EvaluationFunc, typename Rng>
-void Evaluate(Population<T, F>& pop, EvaluationFunc& func, Rng& rng) {
+void EvaluateBatch(Span<T> data, Span<F> fitness, EvaluationFunc& func,
+                   Rng& rng, std::true_type) {
+  func(data, fitness, rng);
+}
+
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+void EvaluateBatch(Span<T> data, Span<F> fitness, EvaluationFunc& func,
+                   Rng& rng, std::false_type) {
+  for (size_t i = 0; i < data.size(); ++i) {
+    fitness[i] = func(data[i], rng);
+  }
+}
+
+/// Compute the fitness of a batch of genomes.
+///
+/// Batch evaluators receive the whole batch at once. Every other evaluation
+/// functor is called once per genome.
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+void EvaluateBatch(Span<T> data, Span<F> fitness, EvaluationFunc& func,
+                   Rng& rng) {
+  assert(data.size() == fitness.size());
+  EvaluateBatch(data, fitness, func, rng,
+                std::integral_constant<bool, IsBatchEvaluator<
+                    EvaluationFunc, T, F, Rng>::value>());
+}
+
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+size_t Evaluate(Population<T, F>& pop, EvaluationFunc& func, Rng& rng,
+                std::false_type) {
+  size_t count = 0;
   for (auto& it : pop) {
     if (it.is_dirty()) {
       it.fitness = func(it.data, rng);
       assert(it.fitness >= 0.0);
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+size_t Evaluate(Population<T, F>& pop, EvaluationFunc& func, Rng& rng,
+                std::true_type) {
+  thread_local std::vector<size_t> dirty;
+  thread_local std::vector<T> data;
+  thread_local std::vector<F> fitness;
+
+  dirty.clear();
+  data.clear();
+  for (size_t i = 0; i < pop.size(); ++i) {
+    if (pop[i].is_dirty()) {
+      dirty.push_back(i);
+      data.push_back(std::move(pop[i].data));
     }
   }
+
+  if (dirty.empty()) {
+    return 0;
+  }
+
+  fitness.assign(dirty.size(), -1.0);
+  func(Span<T>(data.data(), data.size()),
+       Span<F>(fitness.data(), fitness.size()), rng);
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    Individual<T, F>& it = pop[dirty[i]];
+    it.data = std::move(data[i]);
+    it.fitness = fitness[i];
+    assert(it.fitness >= 0.0);
+  }
+
+  return dirty.size();
+}
+
+/// Compute the fitness of the individuals.
+///
+/// If the evaluation functor is a batch evaluator, the genomes of the dirty
+/// individuals are gathered into a contiguous batch and evaluated with a
+/// single call. Returns the number of evaluated individuals.
+template <typename T, typename F, typename EvaluationFunc, typename Rng>
+size_t Evaluate(Population<T, F>& pop, EvaluationFunc& func, Rng& rng) {
+  return Evaluate(pop, func, rng,
+           std::integral_constant<bool, IsBatchEvaluator<
+               EvaluationFunc, T, F, Rng>::value>());
 }
 
 }  // namespace snf
@@ -0,0 +1,484 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_POPULATION_MATRIX_H_
+#define METASINF_INCLUDE_METASINF_POPULATION_MATRIX_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/memory.h"
+#include "metasinf/population.h"
+
+namespace snf {
+
+/// Reference to an individual stored in a `PopulationMatrix`.
+///
+/// The genome is exposed as a `Span` over its row, which the crossover and
+/// mutation functors accept in place of a container.
+template <typename E, typename F>
+struct IndividualRef {
+  using Flag =
+      typename std::conditional<std::is_const<F>::value, const uint8_t,
+                                uint8_t>::type;
+
+  IndividualRef(Span<E> data, F& fitness, Flag& dirty)
+      : data(data), fitness(fitness), dirty_(&dirty) {}
+
+  /// Data value.
+  Span<E> data;
+
+  /// Fitness value.
+  F& fitness;
+
+  /// Return whether the individual is dirty, i.e. whether his fitness needs to
+  /// be recomputed.
+  bool is_dirty() const { return *dirty_ != 0; }
+
+  /// Mark the individual as dirty.
+  void mark_dirty() {
+    *dirty_ = 1;
+    fitness = -1.0;
+  }
+
+  bool operator<(const IndividualRef& rhs) const {
+    return fitness < rhs.fitness;
+  }
+
+  bool operator>(const IndividualRef& rhs) const {
+    return fitness > rhs.fitness;
+  }
+
+ private:
+  Flag* dirty_;
+};
+
+/// Random access iterator over the individuals of a `PopulationMatrix`.
+template <typename Pop, typename Ref>
+struct PopulationMatrixIterator {
+  struct Pointer {
+    Ref ref;
+    Ref* operator->() { return &ref; }
+  };
+
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = Ref;
+  using difference_type = ptrdiff_t;
+  using pointer = Pointer;
+  using reference = Ref;
+
+  PopulationMatrixIterator() : pop_(nullptr), index_(0) {}
+  PopulationMatrixIterator(Pop* pop, size_t index)
+      : pop_(pop), index_(index) {}
+
+  Ref operator*() const { return (*pop_)[index_]; }
+  Pointer operator->() const { return Pointer{(*pop_)[index_]}; }
+  Ref operator[](difference_type n) const { return (*pop_)[index_ + n]; }
+
+  PopulationMatrixIterator& operator++() {
+    ++index_;
+    return *this;
+  }
+
+  PopulationMatrixIterator operator++(int) {
+    PopulationMatrixIterator it = *this;
+    ++index_;
+    return it;
+  }
+
+  PopulationMatrixIterator& operator--() {
+    --index_;
+    return *this;
+  }
+
+  PopulationMatrixIterator operator--(int) {
+    PopulationMatrixIterator it = *this;
+    --index_;
+    return it;
+  }
+
+  PopulationMatrixIterator& operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+
+  PopulationMatrixIterator& operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+
+  PopulationMatrixIterator operator+(difference_type n) const {
+    return PopulationMatrixIterator(pop_, index_ + n);
+  }
+
+  PopulationMatrixIterator operator-(difference_type n) const {
+    return PopulationMatrixIterator(pop_, index_ - n);
+  }
+
+  difference_type operator-(const PopulationMatrixIterator& rhs) const {
+    return static_cast<difference_type>(index_) -
+           static_cast<difference_type>(rhs.index_);
+  }
+
+  bool operator==(const PopulationMatrixIterator& rhs) const {
+    return index_ == rhs.index_;
+  }
+
+  bool operator!=(const PopulationMatrixIterator& rhs) const {
+    return index_ != rhs.index_;
+  }
+
+  bool operator<(const PopulationMatrixIterator& rhs) const {
+    return index_ < rhs.index_;
+  }
+
+  bool operator>(const PopulationMatrixIterator& rhs) const {
+    return index_ > rhs.index_;
+  }
+
+  bool operator<=(const PopulationMatrixIterator& rhs) const {
+    return index_ <= rhs.index_;
+  }
+
+  bool operator>=(const PopulationMatrixIterator& rhs) const {
+    return index_ >= rhs.index_;
+  }
+
+ private:
+  Pop* pop_;
+  size_t index_;
+};
+
+/// Data-oriented population of fixed-length genomes.
+///
+/// The genomes are stored as the rows of a single row-major matrix, with
+/// every row aligned to a cache line. The fitness values and the dirty flags
+/// are kept in separate dense arrays, so that fitness scans do not touch the
+/// genomes.
+template <typename E, typename F>
+struct PopulationMatrix {
+  static constexpr size_t kAlignment = 64;
+
+  using value_type = IndividualRef<E, F>;
+  using reference = IndividualRef<E, F>;
+  using const_reference = IndividualRef<const E, const F>;
+  using iterator = PopulationMatrixIterator<PopulationMatrix, reference>;
+  using const_iterator =
+      PopulationMatrixIterator<const PopulationMatrix, const_reference>;
+
+  /// Construct a population of `size` dirty individuals whose genomes have
+  /// `length` elements.
+  explicit PopulationMatrix(size_t size = 0, size_t length = 0)
+      : size_(0), length_(0), stride_(0) {
+    set_length(length);
+    resize(size);
+  }
+
+  PopulationMatrix(const PopulationMatrix&) = default;
+  PopulationMatrix& operator=(const PopulationMatrix&) = default;
+
+  /// Move the individuals of `other`, which is left empty with the same
+  /// genome length.
+  PopulationMatrix(PopulationMatrix&& other)
+      : size_(other.size_),
+        length_(other.length_),
+        stride_(other.stride_),
+        genes_(std::move(other.genes_)),
+        fitness_(std::move(other.fitness_)),
+        dirty_(std::move(other.dirty_)) {
+    other.clear();
+  }
+
+  PopulationMatrix& operator=(PopulationMatrix&& other) {
+    if (this != &other) {
+      size_ = other.size_;
+      length_ = other.length_;
+      stride_ = other.stride_;
+      genes_ = std::move(other.genes_);
+      fitness_ = std::move(other.fitness_);
+      dirty_ = std::move(other.dirty_);
+      other.clear();
+    }
+
+    return *this;
+  }
+
+  /// Return the number of individuals.
+  size_t size() const { return size_; }
+
+  /// Return whether the population is empty.
+  bool empty() const { return size_ == 0; }
+
+  /// Return the number of elements of each genome.
+  size_t length() const { return length_; }
+
+  /// Return the distance in elements between the starts of two rows.
+  size_t stride() const { return stride_; }
+
+  /// Set the number of elements of each genome. The population must be
+  /// empty.
+  void set_length(size_t length) {
+    assert(empty());
+    length_ = length;
+    stride_ = length;
+    if (kAlignment % sizeof(E) == 0) {
+      size_t lanes = kAlignment / sizeof(E);
+      stride_ = (length + lanes - 1) / lanes * lanes;
+    }
+  }
+
+  /// Return the genome of the specified individual.
+  Span<E> row(size_t index) {
+    assert(index < size_);
+    return Span<E>(genes_.data() + index * stride_, length_);
+  }
+
+  Span<const E> row(size_t index) const {
+    assert(index < size_);
+    return Span<const E>(genes_.data() + index * stride_, length_);
+  }
+
+  /// Return the dense array of fitness values.
+  F* fitness() { return fitness_.data(); }
+  const F* fitness() const { return fitness_.data(); }
+
+  /// Return the dense array of dirty flags.
+  const uint8_t* dirty() const { return dirty_.data(); }
+
+  /// Set the fitness of the specified individual and mark it clean.
+  void set_fitness(size_t index, F fitness) {
+    assert(index < size_);
+    fitness_[index] = fitness;
+    dirty_[index] = 0;
+  }
+
+  reference operator[](size_t index) {
+    assert(index < size_);
+    return reference(row(index), fitness_[index], dirty_[index]);
+  }
+
+  const_reference operator[](size_t index) const {
+    assert(index < size_);
+    return const_reference(row(index), fitness_[index], dirty_[index]);
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  void clear() { resize(0); }
+
+  void reserve(size_t size) {
+    genes_.reserve(size * stride_);
+    fitness_.reserve(size);
+    dirty_.reserve(size);
+  }
+
+  /// Resize the population. New individuals are value-initialized and
+  /// dirty.
+  void resize(size_t size) {
+    genes_.resize(size * stride_);
+    fitness_.resize(size, -1.0);
+    dirty_.resize(size, 1);
+    size_ = size;
+  }
+
+  /// Append a copy of the specified individual.
+  template <typename Ref>
+  void push_back(const Ref& it) {
+    if (empty() && length_ != it.data.size()) {
+      set_length(it.data.size());
+    }
+
+    assert(it.data.size() == length_);
+    F fitness = it.fitness;
+    uint8_t dirty = it.is_dirty();
+    if (genes_.size() + stride_ <= genes_.capacity()) {
+      resize(size_ + 1);
+      std::copy(it.data.begin(), it.data.end(), row(size_ - 1).begin());
+    } else {
+      // Growing moves the rows, and `it` may be a row of this population.
+      thread_local std::vector<E> buffer;
+      buffer.assign(it.data.begin(), it.data.end());
+      resize(size_ + 1);
+      std::copy(buffer.begin(), buffer.end(), row(size_ - 1).begin());
+    }
+
+    fitness_[size_ - 1] = fitness;
+    dirty_[size_ - 1] = dirty;
+  }
+
+  /// Overwrite the specified individual with a copy of another.
+  template <typename Ref>
+  void assign(size_t index, const Ref& it) {
+    assert(it.data.size() == length_);
+    std::copy(it.data.begin(), it.data.end(), row(index).begin());
+    fitness_[index] = it.fitness;
+    dirty_[index] = it.is_dirty();
+  }
+
+  /// Exchange two individuals.
+  void swap_rows(size_t index0, size_t index1) {
+    if (index0 == index1) {
+      return;
+    }
+
+    Span<E> row0 = row(index0);
+    std::swap_ranges(row0.begin(), row0.end(), row(index1).begin());
+    std::swap(fitness_[index0], fitness_[index1]);
+    std::swap(dirty_[index0], dirty_[index1]);
+  }
+
+  /// Exchange an individual with an individual of another population.
+  void swap_rows(size_t index, PopulationMatrix& other, size_t other_index) {
+    assert(other.length_ == length_);
+    Span<E> row0 = row(index);
+    std::swap_ranges(row0.begin(), row0.end(), other.row(other_index).begin());
+    std::swap(fitness_[index], other.fitness_[other_index]);
+    std::swap(dirty_[index], other.dirty_[other_index]);
+  }
+
+  /// Reorder the individuals such that the individual at position `i` is the
+  /// one previously at position `order[i]`.
+  void permute(const std::vector<size_t>& order) {
+    assert(order.size() == size_);
+    std::vector<E, AlignedAllocator<E, kAlignment>> genes(genes_.size());
+    std::vector<F> fitness(size_);
+    std::vector<uint8_t> dirty(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      Span<const E> src = row(order[i]);
+      std::copy(src.begin(), src.end(), genes.data() + i * stride_);
+      fitness[i] = fitness_[order[i]];
+      dirty[i] = dirty_[order[i]];
+    }
+
+    genes_.swap(genes);
+    fitness_.swap(fitness);
+    dirty_.swap(dirty);
+  }
+
+ private:
+  size_t size_;
+  size_t length_;
+  size_t stride_;
+  std::vector<E, AlignedAllocator<E, kAlignment>> genes_;
+  std::vector<F> fitness_;
+  std::vector<uint8_t> dirty_;
+};
+
+template <typename E, typename F>
+constexpr size_t PopulationMatrix<E, F>::kAlignment;
+
+/// Shuffle the individuals.
+template <typename E, typename F, typename Rng>
+void Shuffle(PopulationMatrix<E, F>& pop, Rng& rng) {
+  for (size_t i = pop.size(); i > 1; --i) {
+    std::uniform_int_distribution<size_t> dist(0, i - 1);
+    pop.swap_rows(i - 1, dist(rng));
+  }
+}
+
+/// Move the individual at `src_index` of `src` over the individual at
+/// `dst_index` of `dst`.
+template <typename E, typename F>
+void MoveIndividual(PopulationMatrix<E, F>& src, size_t src_index,
+                    PopulationMatrix<E, F>& dst, size_t dst_index) {
+  dst.assign(dst_index, src[src_index]);
+}
+
+/// Overwrite the individual at `dst_index` of `dst` with a copy of the
+/// individual at `src_index` of `src`.
+template <typename E, typename F>
+void CopyIndividual(const PopulationMatrix<E, F>& src, size_t src_index,
+                    PopulationMatrix<E, F>& dst, size_t dst_index) {
+  dst.assign(dst_index, src[src_index]);
+}
+
+/// Exchange an individual of `pop0` with an individual of `pop1`.
+template <typename E, typename F>
+void SwapIndividuals(PopulationMatrix<E, F>& pop0, size_t index0,
+                     PopulationMatrix<E, F>& pop1, size_t index1) {
+  pop0.swap_rows(index0, pop1, index1);
+}
+
+/// Resize `dst` to `size` individuals with the same genome length as `src`.
+template <typename E, typename F>
+void ResizeLike(PopulationMatrix<E, F>& dst,
+                const PopulationMatrix<E, F>& src, size_t size) {
+  if (dst.length() != src.length()) {
+    dst.clear();
+    dst.set_length(src.length());
+  }
+
+  dst.resize(size);
+}
+
+/// Return the fitness column of the population.
+template <typename E, typename F>
+const F* FitnessArray(const PopulationMatrix<E, F>& pop,
+                      std::vector<F>& buffer) {
+  return pop.fitness();
+}
+
+/// Sort the individuals by descending fitness.
+template <typename E, typename F>
+void SortByFitness(PopulationMatrix<E, F>& pop) {
+  std::vector<size_t> order(pop.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+
+  const F* fitness = pop.fitness();
+  std::sort(order.begin(), order.end(), [fitness](size_t lhs, size_t rhs) {
+    return fitness[lhs] > fitness[rhs];
+  });
+
+  pop.permute(order);
+}
+
+/// Compute the fitness of the individuals.
+///
+/// The evaluation functor receives each genome as a `Span<E>`. Batch
+/// evaluators receive a `Span<Span<E>>` over the rows of the dirty
+/// individuals. Returns the number of evaluated individuals.
+template <typename E, typename F, typename EvaluationFunc, typename Rng>
+size_t Evaluate(PopulationMatrix<E, F>& pop, EvaluationFunc& func, Rng& rng) {
+  thread_local std::vector<size_t> dirty;
+  thread_local std::vector<Span<E>> data;
+  thread_local std::vector<F> fitness;
+
+  dirty.clear();
+  data.clear();
+  for (size_t i = 0; i < pop.size(); ++i) {
+    if (pop.dirty()[i]) {
+      dirty.push_back(i);
+      data.push_back(pop.row(i));
+    }
+  }
+
+  if (dirty.empty()) {
+    return 0;
+  }
+
+  fitness.assign(dirty.size(), -1.0);
+  EvaluateBatch(Span<Span<E>>(data.data(), data.size()),
+                Span<F>(fitness.data(), fitness.size()), func, rng);
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    assert(fitness[i] >= 0.0);
+    pop.set_fitness(dirty[i], fitness[i]);
+  }
+
+  return dirty.size();
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_POPULATION_MATRIX_H_
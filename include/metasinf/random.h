@@ -0,0 +1,434 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_RANDOM_H_
+#define METASINF_INCLUDE_METASINF_RANDOM_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace snf {
+
+/// Philox4x32-10 counter-based random number generator.
+///
+/// Every block of four outputs is a keyed bijection of a 128-bit counter,
+/// made of the 64-bit position of the block and a 64-bit stream identifier.
+/// The state is only 24 bytes, plus a buffer holding the current block.
+/// Jumping to any position and deriving substreams take constant time. The
+/// generator satisfies the uniform random bit generator requirements.
+struct Philox4x32 {
+  using result_type = uint32_t;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0) {
+    this->seed(seed, stream);
+  }
+
+  /// Seed the generator from a seed sequence. Generators are copied, not
+  /// treated as seed sequences.
+  template <typename SeedSeq,
+            typename = typename std::enable_if<
+                !std::is_convertible<SeedSeq, uint64_t>::value &&
+                !std::is_same<typename std::decay<SeedSeq>::type,
+                              Philox4x32>::value>::type>
+  explicit Philox4x32(SeedSeq& seq) {
+    seed(seq);
+  }
+
+  void seed(uint64_t seed = 0, uint64_t stream = 0) {
+    key_[0] = static_cast<uint32_t>(seed);
+    key_[1] = static_cast<uint32_t>(seed >> 32);
+    stream_ = stream;
+    counter_ = 0;
+  }
+
+  template <typename SeedSeq,
+            typename = typename std::enable_if<
+                !std::is_convertible<SeedSeq, uint64_t>::value &&
+                !std::is_same<typename std::decay<SeedSeq>::type,
+                              Philox4x32>::value>::type>
+  void seed(SeedSeq& seq) {
+    uint32_t words[4];
+    seq.generate(words, words + 4);
+    seed(words[0] | static_cast<uint64_t>(words[1]) << 32,
+         words[2] | static_cast<uint64_t>(words[3]) << 32);
+  }
+
+  result_type operator()() {
+    size_t offset = counter_ & 3;
+    if (offset == 0) {
+      Block(counter_ >> 2, buffer_);
+    }
+
+    ++counter_;
+    return buffer_[offset];
+  }
+
+  /// Skip the next `count` outputs.
+  void discard(uint64_t count) { seek(counter_ + count); }
+
+  /// Return the number of outputs generated so far.
+  uint64_t position() const { return counter_; }
+
+  /// Jump to the specified output position.
+  void seek(uint64_t position) {
+    counter_ = position;
+    if ((counter_ & 3) != 0) {
+      Block(counter_ >> 2, buffer_);
+    }
+  }
+
+  /// Return the stream identifier.
+  uint64_t stream() const { return stream_; }
+
+  /// Return an independent generator identified by `id`.
+  ///
+  /// The substream shares the key of the generator and starts at position
+  /// zero; it does not depend on the position of the generator, which is
+  /// left unchanged. Substreams can be nested, e.g.
+  /// `rng.Substream(island).Substream(generation).Substream(individual)`.
+  Philox4x32 Substream(uint64_t id) const {
+    uint32_t counter[4] = {static_cast<uint32_t>(id),
+                           static_cast<uint32_t>(id >> 32),
+                           static_cast<uint32_t>(stream_),
+                           static_cast<uint32_t>(stream_ >> 32)};
+    uint32_t key[2] = {key_[0] ^ kSubstreamTweak, key_[1]};
+    Philox(counter, key);
+
+    Philox4x32 rng(*this);
+    rng.stream_ = counter[0] | static_cast<uint64_t>(counter[1]) << 32;
+    rng.counter_ = 0;
+    return rng;
+  }
+
+  /// Write the next `count` outputs to `dst`.
+  ///
+  /// Whole blocks are generated in batches with independent lanes, which
+  /// compilers vectorize.
+  void Fill(result_type* dst, size_t count) {
+    while (count > 0 && (counter_ & 3) != 0) {
+      *dst++ = operator()();
+      --count;
+    }
+
+    uint64_t block = counter_ >> 2;
+    while (count >= 4 * kLanes) {
+      uint32_t lanes[4][kLanes];
+      for (size_t i = 0; i < kLanes; ++i) {
+        lanes[0][i] = static_cast<uint32_t>(block + i);
+        lanes[1][i] = static_cast<uint32_t>((block + i) >> 32);
+        lanes[2][i] = static_cast<uint32_t>(stream_);
+        lanes[3][i] = static_cast<uint32_t>(stream_ >> 32);
+      }
+
+      uint32_t key0 = key_[0];
+      uint32_t key1 = key_[1];
+      for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < kLanes; ++i) {
+          uint64_t product0 = static_cast<uint64_t>(kMul0) * lanes[0][i];
+          uint64_t product1 = static_cast<uint64_t>(kMul1) * lanes[2][i];
+          uint32_t x0 = static_cast<uint32_t>(product1 >> 32) ^ lanes[1][i] ^
+                        key0;
+          uint32_t x2 = static_cast<uint32_t>(product0 >> 32) ^ lanes[3][i] ^
+                        key1;
+          lanes[0][i] = x0;
+          lanes[1][i] = static_cast<uint32_t>(product1);
+          lanes[2][i] = x2;
+          lanes[3][i] = static_cast<uint32_t>(product0);
+        }
+
+        key0 += kWeyl0;
+        key1 += kWeyl1;
+      }
+
+      for (size_t i = 0; i < kLanes; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+          dst[4 * i + j] = lanes[j][i];
+        }
+      }
+
+      block += kLanes;
+      dst += 4 * kLanes;
+      count -= 4 * kLanes;
+      counter_ += 4 * kLanes;
+    }
+
+    while (count > 0) {
+      *dst++ = operator()();
+      --count;
+    }
+  }
+
+  /// Write the state of the generator to a checkpoint.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(key_[0]);
+    writer.Write(key_[1]);
+    writer.Write(stream_);
+    writer.Write(counter_);
+  }
+
+  /// Restore the state of the generator from a checkpoint.
+  template <typename Reader>
+  void Load(Reader& reader) {
+    uint64_t counter = 0;
+    if (reader.Read(key_[0]) && reader.Read(key_[1]) && reader.Read(stream_) &&
+        reader.Read(counter)) {
+      seek(counter);
+    }
+  }
+
+  friend bool operator==(const Philox4x32& lhs, const Philox4x32& rhs) {
+    return lhs.key_[0] == rhs.key_[0] && lhs.key_[1] == rhs.key_[1] &&
+           lhs.stream_ == rhs.stream_ && lhs.counter_ == rhs.counter_;
+  }
+
+  friend bool operator!=(const Philox4x32& lhs, const Philox4x32& rhs) {
+    return !(lhs == rhs);
+  }
+
+  template <typename CharT, typename Traits>
+  friend std::basic_ostream<CharT, Traits>& operator<<(
+      std::basic_ostream<CharT, Traits>& out, const Philox4x32& rng) {
+    return out << rng.key_[0] << ' ' << rng.key_[1] << ' ' << rng.stream_
+               << ' ' << rng.counter_;
+  }
+
+  template <typename CharT, typename Traits>
+  friend std::basic_istream<CharT, Traits>& operator>>(
+      std::basic_istream<CharT, Traits>& in, Philox4x32& rng) {
+    uint32_t key0, key1;
+    uint64_t stream, counter;
+    if (in >> key0 >> key1 >> stream >> counter) {
+      rng.key_[0] = key0;
+      rng.key_[1] = key1;
+      rng.stream_ = stream;
+      rng.seek(counter);
+    }
+
+    return in;
+  }
+
+  /// Apply the Philox4x32-10 bijection to `counter` in place.
+  static void Philox(uint32_t counter[4], const uint32_t key[2]) {
+    uint32_t key0 = key[0];
+    uint32_t key1 = key[1];
+    for (int round = 0; round < kRounds; ++round) {
+      uint64_t product0 = static_cast<uint64_t>(kMul0) * counter[0];
+      uint64_t product1 = static_cast<uint64_t>(kMul1) * counter[2];
+      uint32_t x0 = static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key0;
+      uint32_t x2 = static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key1;
+      counter[0] = x0;
+      counter[1] = static_cast<uint32_t>(product1);
+      counter[2] = x2;
+      counter[3] = static_cast<uint32_t>(product0);
+      key0 += kWeyl0;
+      key1 += kWeyl1;
+    }
+  }
+
+ private:
+  enum : uint32_t {
+    kMul0 = 0xd2511f53,
+    kMul1 = 0xcd9e8d57,
+    kWeyl0 = 0x9e3779b9,
+    kWeyl1 = 0xbb67ae85,
+    kSubstreamTweak = 0x5bd1e995
+  };
+
+  enum : int { kRounds = 10 };
+
+  enum : size_t { kLanes = 8 };
+
+  void Block(uint64_t block, uint32_t* dst) const {
+    dst[0] = static_cast<uint32_t>(block);
+    dst[1] = static_cast<uint32_t>(block >> 32);
+    dst[2] = static_cast<uint32_t>(stream_);
+    dst[3] = static_cast<uint32_t>(stream_ >> 32);
+    Philox(dst, key_);
+  }
+
+  uint32_t key_[2];
+  uint64_t stream_;
+  uint64_t counter_;
+  uint32_t buffer_[4];
+};
+
+/// Append to `indices` the indices of the successful trials among `count`
+/// independent Bernoulli trials with success probability `prob`.
+///
+/// Small probabilities are sampled by skipping over the failures with
+/// geometrically distributed gaps, which takes one uniform draw per success.
+/// Larger probabilities compare 16-bit slices of packed 32-bit random words
+/// against the probability, which takes one draw per two trials; the
+/// probability is then rounded to a multiple of 2^-16. Probabilities of zero
+/// and one are exact.
+template <typename Rng>
+void SampleBernoulli(double prob, size_t count, std::vector<size_t>& indices,
+                     Rng& rng) {
+  static constexpr double kSkipThreshold = 0.125;
+
+  assert(prob >= 0.0 && prob <= 1.0);
+  if (prob <= 0.0 || count == 0) {
+    return;
+  }
+
+  if (prob < kSkipThreshold) {
+    std::uniform_real_distribution<double> dist;
+    double scale = 1.0 / std::log1p(-prob);
+    for (size_t i = 0;; ++i) {
+      double skip = std::floor(std::log(1.0 - dist(rng)) * scale);
+      if (skip >= static_cast<double>(count - i)) {
+        return;
+      }
+
+      i += static_cast<size_t>(skip);
+      indices.push_back(i);
+    }
+  }
+
+  uint32_t threshold = static_cast<uint32_t>(prob * 65536.0 + 0.5);
+  std::uniform_int_distribution<uint32_t> dist(
+      0, std::numeric_limits<uint32_t>::max());
+  size_t i = 0;
+  for (; i + 1 < count; i += 2) {
+    uint32_t word = dist(rng);
+    if ((word & 0xffff) < threshold) {
+      indices.push_back(i);
+    }
+
+    if ((word >> 16) < threshold) {
+      indices.push_back(i + 1);
+    }
+  }
+
+  if (i < count && (dist(rng) & 0xffff) < threshold) {
+    indices.push_back(i);
+  }
+}
+
+/// Check whether a random number generator writes 32-bit outputs in bulk.
+///
+/// Such generators, like `Philox4x32`, provide `rng.Fill(dst, count)`.
+template <typename Rng>
+struct HasFill {
+  template <typename U>
+  static auto Test(U* rng) -> decltype(
+      rng->Fill(std::declval<uint32_t*>(), std::declval<size_t>()),
+      std::integral_constant<
+          bool, std::is_same<typename U::result_type, uint32_t>::value>());
+
+  static std::false_type Test(...);
+
+  static constexpr bool value =
+      decltype(Test(static_cast<Rng*>(nullptr)))::value;
+};
+
+template <typename Rng>
+void FillWords(uint32_t* dst, size_t count, Rng& rng, std::true_type) {
+  rng.Fill(dst, count);
+}
+
+template <typename Rng>
+void FillWords(uint32_t* dst, size_t count, Rng& rng, std::false_type) {
+  std::uniform_int_distribution<uint32_t> dist(
+      0, std::numeric_limits<uint32_t>::max());
+  for (size_t i = 0; i < count; ++i) {
+    dst[i] = dist(rng);
+  }
+}
+
+/// Write `count` independent indices, uniformly distributed in
+/// [0, `range`), to `dst`.
+///
+/// The random words are drawn in bulk and mapped to the range with a
+/// multiplication and a shift. Words that would bias the result are
+/// rejected and redrawn, which happens with probability below
+/// `range / 2^32`.
+template <typename Rng>
+void SampleIndices(uint32_t range, size_t count, uint32_t* dst, Rng& rng) {
+  assert(range > 0);
+  FillWords(dst, count, rng,
+            std::integral_constant<bool, HasFill<Rng>::value>());
+
+  std::uniform_int_distribution<uint32_t> dist(
+      0, std::numeric_limits<uint32_t>::max());
+  uint32_t threshold = static_cast<uint32_t>(-range) % range;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t product = static_cast<uint64_t>(dst[i]) * range;
+    while (static_cast<uint32_t>(product) < threshold) {
+      product = static_cast<uint64_t>(dist(rng)) * range;
+    }
+
+    dst[i] = static_cast<uint32_t>(product >> 32);
+  }
+}
+
+/// Write `count` 64-bit words to `dst`, whose bits are independent Bernoulli
+/// trials with success probability `prob`.
+///
+/// The probability is rounded to a multiple of 2^-16 and the words are built
+/// from its binary digits, least significant first: a one bit ORs the word
+/// with a fresh random word and a zero bit ANDs it, so every step halves the
+/// probability and adds the digit. That takes one random word per digit
+/// after the last nonzero one, e.g. a single one for a probability of 0.5,
+/// and the loops over the words are vectorized by compilers.
+template <typename Rng>
+void SampleBernoulliWords(double prob, uint64_t* dst, size_t count,
+                          Rng& rng) {
+  enum : size_t { kChunk = 256 };
+  enum : uint32_t { kDigits = 16 };
+  thread_local std::vector<uint32_t> random;
+
+  assert(prob >= 0.0 && prob <= 1.0);
+  uint32_t threshold = static_cast<uint32_t>(prob * 65536.0 + 0.5);
+  if (threshold == 0 || threshold >= 1u << kDigits) {
+    std::fill(dst, dst + count, threshold == 0 ? 0 : ~uint64_t(0));
+    return;
+  }
+
+  uint32_t low = 0;
+  while ((threshold >> low & 1) == 0) {
+    ++low;
+  }
+
+  random.resize(2 * kChunk);
+  for (size_t begin = 0; begin < count; begin += kChunk) {
+    size_t size = std::min<size_t>(kChunk, count - begin);
+    uint64_t* words = dst + begin;
+    const uint32_t* halves = random.data();
+    std::fill(words, words + size, 0);
+    for (uint32_t digit = low; digit < kDigits; ++digit) {
+      FillWords(random.data(), 2 * size, rng,
+                std::integral_constant<bool, HasFill<Rng>::value>());
+      if (threshold >> digit & 1) {
+        for (size_t i = 0; i < size; ++i) {
+          words[i] |= halves[2 * i] |
+                      static_cast<uint64_t>(halves[2 * i + 1]) << 32;
+        }
+      } else {
+        for (size_t i = 0; i < size; ++i) {
+          words[i] &= halves[2 * i] |
+                      static_cast<uint64_t>(halves[2 * i + 1]) << 32;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_RANDOM_H_
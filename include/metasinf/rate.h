@@ -0,0 +1,189 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_RATE_H_
+#define METASINF_INCLUDE_METASINF_RATE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace snf {
+
+/// Outcome of the variation operators during a generation.
+///
+/// A child is successful if it is fitter than the parent it was copied
+/// from. A crossover is successful if at least one of its children is.
+struct RateFeedback {
+  RateFeedback()
+      : offspring(0),
+        improved(0),
+        crossovers(0),
+        crossover_successes(0),
+        mutations(0),
+        mutation_successes(0) {}
+
+  /// Number of children.
+  size_t offspring;
+
+  /// Number of successful children.
+  size_t improved;
+
+  /// Number of crossovers.
+  size_t crossovers;
+
+  /// Number of successful crossovers.
+  size_t crossover_successes;
+
+  /// Number of mutated children.
+  size_t mutations;
+
+  /// Number of successful mutated children.
+  size_t mutation_successes;
+};
+
+/// Keep the rates fixed.
+struct RateFixed {
+  template <typename Rng>
+  void operator()(double& mutation_rate, double& crossover_rate,
+                  const RateFeedback& feedback, Rng& rng) {}
+};
+
+/// Adapt the mutation rate with a 1/5th success rule.
+///
+/// While fewer mutations than the target ratio succeed, the search is
+/// considered stuck and the mutation rate is divided by `factor`; while more
+/// succeed, it is multiplied by it, within the specified bounds. The
+/// crossover rate is left unchanged.
+struct RateOneFifth {
+  explicit RateOneFifth(double factor = 0.85, double target = 0.2,
+                        double lower_bound = 0.001, double upper_bound = 1.0)
+      : factor(factor),
+        target(target),
+        lower_bound(lower_bound),
+        upper_bound(upper_bound) {}
+
+  /// Adaptation factor, between zero and one.
+  double factor;
+
+  /// Target ratio of successful mutations.
+  double target;
+
+  /// Lower bound of the mutation rate.
+  double lower_bound;
+
+  /// Upper bound of the mutation rate.
+  double upper_bound;
+
+  template <typename Rng>
+  void operator()(double& mutation_rate, double& crossover_rate,
+                  const RateFeedback& feedback, Rng& rng) {
+    assert(factor > 0.0 && factor < 1.0);
+    if (feedback.mutations == 0) {
+      return;
+    }
+
+    double ratio =
+        static_cast<double>(feedback.mutation_successes) / feedback.mutations;
+    if (ratio > target) {
+      mutation_rate *= factor;
+    } else if (ratio < target) {
+      mutation_rate /= factor;
+    }
+
+    mutation_rate = std::min(std::max(mutation_rate, lower_bound), upper_bound);
+  }
+};
+
+/// Choose the rates among a set of candidates with adaptive pursuit.
+///
+/// Each candidate pair of mutation and crossover rates is an arm. Every
+/// generation uses the rates of an arm drawn according to the selection
+/// probabilities, and credits the arm with the ratio of successful children.
+/// The quality estimate of the arm follows its credits with the adaptation
+/// rate, and the probabilities pursue the arm with the best estimate with
+/// the learning rate, without falling below the minimum probability.
+struct RatePursuit {
+  /// Construct a controller over the specified (mutation rate, crossover
+  /// rate) pairs. A minimum probability of zero selects `0.5 / arms.size()`.
+  explicit RatePursuit(const std::vector<std::pair<double, double>>& arms,
+                       double adaptation_rate = 0.8,
+                       double learning_rate = 0.8, double min_prob = 0.0)
+      : arms(arms),
+        adaptation_rate(adaptation_rate),
+        learning_rate(learning_rate),
+        min_prob(min_prob > 0.0 ? min_prob : 0.5 / arms.size()),
+        quality_(arms.size(), 0.0),
+        prob_(arms.size(), 1.0 / arms.size()),
+        current_(arms.size()) {}
+
+  /// Candidate (mutation rate, crossover rate) pairs.
+  std::vector<std::pair<double, double>> arms;
+
+  /// Adaptation rate of the quality estimates.
+  double adaptation_rate;
+
+  /// Learning rate of the selection probabilities.
+  double learning_rate;
+
+  /// Minimum selection probability of each arm.
+  double min_prob;
+
+  /// Return the selection probabilities of the arms.
+  const std::vector<double>& prob() const { return prob_; }
+
+  template <typename Rng>
+  void operator()(double& mutation_rate, double& crossover_rate,
+                  const RateFeedback& feedback, Rng& rng) {
+    assert(!arms.empty());
+    assert(min_prob * arms.size() < 1.0);
+
+    // The first generation runs with the initial rates of the algorithm,
+    // which are not credited to any arm.
+    if (current_ < arms.size() && feedback.offspring > 0) {
+      double reward =
+          static_cast<double>(feedback.improved) / feedback.offspring;
+      quality_[current_] += adaptation_rate * (reward - quality_[current_]);
+
+      size_t best = std::max_element(quality_.begin(), quality_.end()) -
+                    quality_.begin();
+      double max_prob = 1.0 - (arms.size() - 1) * min_prob;
+      for (size_t i = 0; i < arms.size(); ++i) {
+        double target = i == best ? max_prob : min_prob;
+        prob_[i] += learning_rate * (target - prob_[i]);
+      }
+    }
+
+    std::discrete_distribution<size_t> dist(prob_.begin(), prob_.end());
+    current_ = dist(rng);
+    mutation_rate = arms[current_].first;
+    crossover_rate = arms[current_].second;
+  }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(quality_);
+    writer.Write(prob_);
+    writer.Write(static_cast<uint64_t>(current_));
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    uint64_t current = 0;
+    if (reader.Read(quality_) && reader.Read(prob_) && reader.Read(current)) {
+      current_ = current;
+    }
+  }
+
+ private:
+  std::vector<double> quality_;
+  std::vector<double> prob_;
+  size_t current_;
+};
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_RATE_H_
@@ -8,15 +8,17 @@
 #include <functional>
 #include <random>
 #include <utility>
+#include <vector>
 
+#include "metasinf/fitness_index.h"
 #include "metasinf/population.h"
 
 namespace snf {
 
 /// Replace the entire population.
 struct ReplacementAll {
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
     dst = std::move(src);
   }
 };
@@ -28,11 +30,23 @@ struct ReplacementElitist {
   /// Elitism size.
   SelectionSize size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
-    size_t count = size(dst.size());
-    std::sort(dst.begin(), dst.end(), std::greater<Individual<T, F>>());
-    dst.resize(count);
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> survivors;
+
+    // Move the survivors to the front of the population in their original
+    // order; with ascending indices each one is swapped with an individual
+    // that does not survive.
+    survivors.clear();
+    FittestIndices(dst, size(dst.size()), survivors);
+    std::sort(survivors.begin(), survivors.end());
+    for (size_t i = 0; i < survivors.size(); ++i) {
+      if (survivors[i] != i) {
+        SwapIndividuals(dst, survivors[i], dst, i);
+      }
+    }
+
+    dst.resize(survivors.size());
 
     dst.reserve(dst.size() + src.size());
     std::move(src.begin(), src.end(), std::back_inserter(dst));
@@ -40,6 +54,45 @@ struct ReplacementElitist {
   }
 };
 
+/// Replace the worst individual of the population with each offspring.
+///
+/// Intended for steady-state algorithms, which produce a few offspring at a
+/// time. The population size is preserved. The worst individual is tracked
+/// with a `FitnessIndex` over the fitness values converted to `double`. The
+/// index is kept between calls and only rebuilt when the functor is given
+/// another population, or one of another size, so each offspring costs
+/// O(log n). Between calls the population must only be changed by this
+/// functor; a new functor starts with an empty index.
+struct ReplacementWorst {
+  ReplacementWorst() : indexed_(nullptr) {}
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    size_t first = 0;
+    if (dst.empty() && !src.empty()) {
+      dst.push_back(std::move(src[0]));
+      first = 1;
+    }
+
+    if (indexed_ != &dst || index_.size() != dst.size()) {
+      index_.Build(dst);
+      indexed_ = &dst;
+    }
+
+    for (size_t i = first; i < src.size(); ++i) {
+      size_t worst = index_.worst();
+      MoveIndividual(src, i, dst, worst);
+      index_.Update(worst, dst[worst].fitness);
+    }
+
+    src.clear();
+  }
+
+ private:
+  FitnessIndex<double> index_;
+  const void* indexed_;
+};
+
 }  // namespace snf
 
 #endif  // METASINF_INCLUDE_METASINF_REPLACEMENT_H_
@@ -4,11 +4,20 @@
 #ifndef METASINF_INCLUDE_METASINF_SELECTION_H_
 #define METASINF_INCLUDE_METASINF_SELECTION_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
 #include <vector>
 
+#include "metasinf/parallel.h"
 #include "metasinf/population.h"
+#include "metasinf/random.h"
+#include "metasinf/stats.h"
 
 namespace snf {
 
@@ -21,17 +30,33 @@ struct SelectionRandom {
   /// Number of individuals to select.
   SelectionSize size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
     size_t samples = size(src.size());
-    dst.reserve(samples);
+    dst.reserve(dst.size() + samples);
 
     std::uniform_int_distribution<size_t> dist(0, src.size() - 1);
     for (size_t i = 0; i < samples; ++i) {
-      size_t index = dist(rng);
-      dst.push_back(src[index]);
+      dst.push_back(dist(rng));
     }
   }
+
+  /// Select a single individual and return its index.
+  template <typename Pop, typename Rng>
+  size_t Draw(const Pop& src, Rng& rng) const {
+    assert(!src.empty());
+    std::uniform_int_distribution<size_t> dist(0, src.size() - 1);
+    return dist(rng);
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
 };
 
 /// Truncation selection.
@@ -44,13 +69,18 @@ struct SelectionTruncate {
   /// Number of individuals to select.
   SelectionSize size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
-    std::sort(src.begin(), src.end(), std::greater<Individual<T, F>>());
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    FittestIndices(src, size(src.size()), dst);
+  }
 
-    size_t samples = size(src.size());
-    dst.reserve(dst.size() + samples);
-    dst.insert(dst.end(), src.begin(), src.begin() + samples);
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
   }
 };
 
@@ -70,8 +100,9 @@ struct SelectionRouletteWheel {
   /// Number of individuals to select.
   SelectionSize size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    using F = FitnessType<Pop>;
     thread_local std::vector<F> cum_fitness;
 
     if (src.empty()) {
@@ -84,22 +115,220 @@ struct SelectionRouletteWheel {
       cum_fitness[i] = src[i].fitness + cum_fitness[i - 1];
     }
 
-    F total_fitness = 0.0;
-    for (const auto& it : src) {
-      total_fitness += it.fitness;
-    }
-
+    F total_fitness = cum_fitness.back();
     std::uniform_real_distribution<F> dist(0.0, total_fitness);
     size_t samples = size(src.size());
-    dst.reserve(samples);
+    dst.reserve(dst.size() + samples);
     for (size_t i = 0; i < samples; ++i) {
       F selection = dist(rng);
       size_t index = std::distance(
           cum_fitness.begin(),
           std::lower_bound(cum_fitness.begin(), cum_fitness.end(), selection));
-      dst.push_back(src[index]);
+      dst.push_back(index);
+    }
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
+};
+
+/// Alias table for sampling indices in proportion to their weights.
+///
+/// The table is built in linear time with Vose's method, after which each
+/// index is drawn in constant time with one column lookup and one biased
+/// coin flip. Each column holds its acceptance threshold and its alias next
+/// to each other, so that a draw touches a single cache line. Weights must
+/// be non-negative; if they are all zero, the indices are drawn uniformly.
+struct AliasTable {
+  /// Build the table from a sequence of weights.
+  template <typename It>
+  void Build(It first, It last) {
+    thread_local std::vector<double> scaled;
+    thread_local std::vector<uint32_t> small;
+    thread_local std::vector<uint32_t> large;
+
+    size_t size = std::distance(first, last);
+    assert(size <= std::numeric_limits<uint32_t>::max());
+    scaled.assign(first, last);
+    columns_.resize(size);
+
+    double total = 0.0;
+    for (double it : scaled) {
+      assert(it >= 0.0);
+      total += it;
+    }
+
+    small.clear();
+    large.clear();
+    for (size_t i = 0; i < size; ++i) {
+      scaled[i] = total > 0.0 ? scaled[i] * size / total : 1.0;
+      if (scaled[i] < 1.0) {
+        small.push_back(static_cast<uint32_t>(i));
+      } else {
+        large.push_back(static_cast<uint32_t>(i));
+      }
+    }
+
+    while (!small.empty() && !large.empty()) {
+      uint32_t less = small.back();
+      uint32_t more = large.back();
+      small.pop_back();
+      columns_[less].threshold = Threshold(scaled[less]);
+      columns_[less].alias = more;
+
+      scaled[more] -= 1.0 - scaled[less];
+      if (scaled[more] < 1.0) {
+        large.pop_back();
+        small.push_back(more);
+      }
+    }
+
+    // The remaining columns are full, up to rounding errors.
+    for (uint32_t it : large) {
+      columns_[it].threshold = kFull;
+      columns_[it].alias = it;
+    }
+
+    for (uint32_t it : small) {
+      columns_[it].threshold = kFull;
+      columns_[it].alias = it;
+    }
+  }
+
+  /// Build the table from the fitness values of a population.
+  template <typename Pop>
+  void Build(const Pop& pop) {
+    thread_local std::vector<double> weights;
+
+    weights.resize(pop.size());
+    for (size_t i = 0; i < pop.size(); ++i) {
+      weights[i] = pop[i].fitness;
+    }
+
+    Build(weights.begin(), weights.end());
+  }
+
+  /// Return the number of indices.
+  size_t size() const { return columns_.size(); }
+
+  /// Draw an index.
+  template <typename Rng>
+  size_t operator()(Rng& rng) const {
+    assert(!columns_.empty());
+    std::uniform_int_distribution<size_t> column_dist(0, columns_.size() - 1);
+    std::uniform_int_distribution<uint32_t> coin_dist(0, kFull);
+    size_t index = column_dist(rng);
+    const Column& column = columns_[index];
+    return coin_dist(rng) < column.threshold ? index : column.alias;
+  }
+
+ private:
+  struct Column {
+    uint32_t threshold;
+    uint32_t alias;
+  };
+
+  enum : uint32_t { kFull = 0xffffffff };
+
+  // Return the threshold below which a 32-bit word is accepted with the
+  // specified probability, which is less than one.
+  static uint32_t Threshold(double prob) {
+    return static_cast<uint32_t>(std::max(prob, 0.0) * 4294967296.0);
+  }
+
+  std::vector<Column> columns_;
+};
+
+/// Roulette-wheel selection with an alias table.
+///
+/// The selection probabilities are identical to those of
+/// `SelectionRouletteWheel`. After a linear-time build, each individual is
+/// selected in constant time instead of by a binary search.
+struct SelectionAlias {
+  explicit SelectionAlias(SelectionSize size) : size(size) {}
+
+  /// Number of individuals to select.
+  SelectionSize size;
+
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    thread_local AliasTable table;
+
+    if (src.empty()) {
+      return;
+    }
+
+    table.Build(src);
+    size_t samples = size(src.size());
+    dst.reserve(dst.size() + samples);
+    for (size_t i = 0; i < samples; ++i) {
+      dst.push_back(table(rng));
+    }
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
+};
+
+/// Roulette-wheel selection by stochastic acceptance.
+///
+/// An individual is drawn uniformly at random and accepted with probability
+/// equal to its fitness divided by the maximum fitness; otherwise the draw
+/// is repeated. The selection probabilities are identical to those of
+/// `SelectionRouletteWheel`. Only the maximum fitness is computed up front,
+/// and the expected number of draws per selection is the ratio of the
+/// maximum to the mean fitness, which is small unless a few individuals
+/// dominate the population.
+struct SelectionStochasticAcceptance {
+  explicit SelectionStochasticAcceptance(SelectionSize size) : size(size) {}
+
+  /// Number of individuals to select.
+  SelectionSize size;
+
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    using F = FitnessType<Pop>;
+
+    if (src.empty()) {
+      return;
+    }
+
+    F max_fitness = std::max<F>(ComputeStats(src).max, 0.0);
+
+    std::uniform_int_distribution<size_t> index_dist(0, src.size() - 1);
+    std::uniform_real_distribution<F> accept_dist(0.0, max_fitness);
+    size_t samples = size(src.size());
+    dst.reserve(dst.size() + samples);
+    for (size_t i = 0; i < samples; ++i) {
+      size_t index = index_dist(rng);
+      while (max_fitness > 0.0 && accept_dist(rng) >= src[index].fitness) {
+        index = index_dist(rng);
+      }
+
+      dst.push_back(index);
     }
   }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
 };
 
 /// Stochastic universal sampling.
@@ -116,15 +345,13 @@ struct SelectionSus {
   /// Number of individuals to select.
   SelectionSize size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    using F = FitnessType<Pop>;
     size_t samples = size(src.size());
-    dst.reserve(samples);
+    dst.reserve(dst.size() + samples);
 
-    F total_fitness = 0.0;
-    for (const auto& it : src) {
-      total_fitness += it.fitness;
-    }
+    F total_fitness = ComputeStats(src).sum;
 
     std::uniform_real_distribution<F> dist;
     F offset = dist(rng);
@@ -134,11 +361,20 @@ struct SelectionSus {
     for (size_t i = 0; i < src.size(); ++i) {
       cum_exp += samples * src[i].fitness / total_fitness;
       while (cum_exp > offset + index) {
-        dst.push_back(src[i]);
+        dst.push_back(i);
         ++index;
       }
     }
   }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
 };
 
 /// Tournament selection.
@@ -146,6 +382,12 @@ struct SelectionSus {
 /// In tournament selection a number of individuals are chosen randomly from
 /// the population and the best individual from this group is selected as
 /// parent. This process is repeated as often as individuals must be chosen.
+///
+/// The tournaments are run in blocks over a contiguous copy of the fitness
+/// values: the contestants of a whole block are drawn at once, and each
+/// round compares one contestant of every tournament of the block, so the
+/// fitness loads are independent of each other. The population may hold at
+/// most 2^32 - 1 individuals.
 struct SelectionTournament {
   SelectionTournament(SelectionSize size, int tournament_size)
       : size(size), tournament_size(tournament_size) {}
@@ -156,39 +398,147 @@ struct SelectionTournament {
   /// Size of each tournament.
   int tournament_size;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
+  template <typename Pop, typename Rng>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    thread_local std::vector<FitnessType<Pop>> buffer;
+
     assert(tournament_size > 0);
+    assert(src.size() <= std::numeric_limits<uint32_t>::max());
+    if (src.empty()) {
+      return;
+    }
 
-    std::uniform_int_distribution<size_t> dist(0, src.size() - 1);
     size_t samples = size(src.size());
-    dst.reserve(samples);
-    for (size_t i = 0; i < samples; ++i) {
-      size_t best = dist(rng);
-      for (int j = 0; j < tournament_size - 1; ++j) {
-        size_t index = dist(rng);
-        if (src[index].fitness > src[best].fitness) {
-          best = index;
+    size_t offset = dst.size();
+    dst.resize(offset + samples);
+    Run(FitnessArray(src, buffer), static_cast<uint32_t>(src.size()), samples,
+        dst.data() + offset, rng);
+  }
+
+  /// Plan the tournaments in parallel, using the specified executor.
+  ///
+  /// The tournaments are split into fixed chunks, and every chunk draws its
+  /// random numbers from its own stream, derived from a key drawn from `rng`
+  /// and from the index of the chunk. The plan therefore does not depend on
+  /// the executor or its number of workers.
+  template <typename Pop, typename Rng, typename Executor>
+  void Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng,
+            Executor& executor) {
+    thread_local std::vector<FitnessType<Pop>> buffer;
+
+    assert(tournament_size > 0);
+    assert(src.size() <= std::numeric_limits<uint32_t>::max());
+    if (src.empty()) {
+      return;
+    }
+
+    uint64_t key = rng();
+    key = (key << 32) ^ rng();
+
+    size_t samples = size(src.size());
+    size_t offset = dst.size();
+    dst.resize(offset + samples);
+
+    const FitnessType<Pop>* fitness = FitnessArray(src, buffer);
+    uint32_t range = static_cast<uint32_t>(src.size());
+    size_t* winners = dst.data() + offset;
+    size_t chunk_count = (samples + kChunk - 1) / kChunk;
+    std::atomic<size_t> next(0);
+    executor([&](size_t worker) {
+      for (size_t i = next++; i < chunk_count; i = next++) {
+        Rng stream = StreamRng<Rng>(key, i);
+        size_t first = i * kChunk;
+        Run(fitness, range, std::min<size_t>(kChunk, samples - first),
+            winners + first, stream);
+      }
+    });
+  }
+
+  /// Run a single tournament and return the index of its winner. Only the
+  /// contestants are visited.
+  template <typename Pop, typename Rng>
+  size_t Draw(const Pop& src, Rng& rng) const {
+    assert(tournament_size > 0 && !src.empty());
+    std::uniform_int_distribution<size_t> dist(0, src.size() - 1);
+    size_t best = dist(rng);
+    for (int i = 1; i < tournament_size; ++i) {
+      size_t index = dist(rng);
+      if (src[index].fitness > src[best].fitness) {
+        best = index;
+      }
+    }
+
+    return best;
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
+
+ private:
+  enum : size_t { kBlock = 256, kChunk = 16384 };
+
+  // Write the winners of `count` tournaments among `range` individuals to
+  // `dst`. The contestants of a block are stored round by round.
+  template <typename F, typename Rng>
+  void Run(const F* fitness, uint32_t range, size_t count, size_t* dst,
+           Rng& rng) const {
+    thread_local std::vector<uint32_t> contestants;
+
+    size_t rounds = tournament_size;
+    contestants.resize(kBlock * rounds);
+    for (size_t first = 0; first < count; first += kBlock) {
+      size_t block = std::min<size_t>(kBlock, count - first);
+      SampleIndices(range, block * rounds, contestants.data(), rng);
+
+      uint32_t best[kBlock];
+      F best_fitness[kBlock];
+      for (size_t i = 0; i < block; ++i) {
+        best[i] = contestants[i];
+        best_fitness[i] = fitness[best[i]];
+      }
+
+      for (size_t round = 1; round < rounds; ++round) {
+        const uint32_t* indices = contestants.data() + round * block;
+        for (size_t i = 0; i < block; ++i) {
+          uint32_t index = indices[i];
+          F value = fitness[index];
+          bool better = value > best_fitness[i];
+          best[i] = better ? index : best[i];
+          best_fitness[i] = better ? value : best_fitness[i];
         }
       }
 
-      dst.push_back(src[best]);
+      for (size_t i = 0; i < block; ++i) {
+        dst[first + i] = best[i];
+      }
     }
   }
 };
 
 /// Linear rank-based fitness assignment.
 struct FitnessRankLinear {
-  template <typename F>
-  F operator()(size_t rank, size_t size) {
+  double operator()(size_t rank, size_t size) {
     return size - rank;
   }
 };
 
 /// Rank-based selection.
 ///
-/// The individuals are sorted according their fitness. The selection
-/// probability of the individuals is adjusted according to their rank.
+/// The individuals are ranked according their fitness. The selection
+/// probability of the individuals is adjusted according to their rank. The
+/// selected individuals keep their original fitness.
+///
+/// If the wrapped selection algorithm provides a selection plan, it plans
+/// on a `FitnessView` of the ranks and no genome is copied but those of the
+/// selected individuals. Otherwise it selects from a ranked copy of the
+/// population, and the selected individuals are marked dirty, since only
+/// their rank fitness is known.
 ///
 /// Rank-based fitness assignment overcomes the scaling problems of the
 /// proportional fitness assignment.
@@ -204,17 +554,69 @@ struct SelectionRank {
   /// Fitness assignment function.
   FitnessFunc fitness;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
-    thread_local Population<T, F> tmp;
+  template <typename Pop, typename Rng, typename S = SelectionFunc>
+  typename std::enable_if<
+      HasSelectionPlan<S, FitnessView<FitnessType<Pop>>, Rng>::value>::type
+  Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    thread_local FitnessView<FitnessType<Pop>> view;
+
+    Rank(src, view);
+    selection.Plan(view, dst, rng);
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    Select(src, dst, rng,
+           std::integral_constant<bool, HasSelectionPlan<
+               SelectionFunc, FitnessView<FitnessType<Pop>>, Rng>::value>());
+  }
+
+ private:
+  // Copy the rank fitness of the individuals to `view`.
+  template <typename Pop>
+  void Rank(const Pop& src, FitnessView<FitnessType<Pop>>& view) {
+    thread_local std::vector<size_t> order;
+
+    ViewFitness(src, view);
+    order.resize(view.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&view](size_t lhs, size_t rhs) {
+      return view[lhs].fitness > view[rhs].fitness;
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+      view[order[i]].fitness = fitness(i, order.size());
+    }
+  }
+
+  template <typename Pop, typename Rng>
+  void Select(Pop& src, Pop& dst, Rng& rng, std::true_type) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
+
+  template <typename Pop, typename Rng>
+  void Select(Pop& src, Pop& dst, Rng& rng, std::false_type) {
+    thread_local FitnessView<FitnessType<Pop>> view;
+    thread_local Pop tmp;
 
+    Rank(src, view);
     tmp = src;
-    std::sort(tmp.begin(), tmp.end(), std::greater<Individual<T, F>>());
     for (size_t i = 0; i < tmp.size(); ++i) {
-      tmp[i].fitness = fitness(i, tmp.size());
+      tmp[i].fitness = view[i].fitness;
     }
 
+    size_t size = dst.size();
     selection(tmp, dst, rng);
+    for (size_t i = size; i < dst.size(); ++i) {
+      dst[i].mark_dirty();
+    }
   }
 };
 
@@ -234,10 +636,14 @@ struct FitnessSigmaDefault {
 /// Sigma-scaling selection.
 ///
 /// The selection probablity of the individuals is adjusted according to the
-/// mean population fitness and the fitness standard deviation.
+/// mean population fitness and the fitness standard deviation. The selected
+/// individuals keep their original fitness.
 ///
 /// Sigma-scaling helps avoid premature convergence and amplifies minor
-/// fitness differences.
+/// fitness differences. As with `SelectionRank`, a wrapped selection
+/// algorithm with a selection plan plans on a `FitnessView` of the scaled
+/// fitness; one without selects from a scaled copy of the population and
+/// marks the selected individuals dirty.
 template <typename SelectionFunc, typename FitnessFunc = FitnessSigmaDefault>
 struct SelectionSigma {
   SelectionSigma(const SelectionFunc& selection = SelectionFunc(),
@@ -250,33 +656,71 @@ struct SelectionSigma {
   /// Fitness assignment function.
   FitnessFunc fitness;
 
-  template <typename T, typename F, typename Rng>
-  void operator()(Population<T, F>& src, Population<T, F>& dst, Rng& rng) {
-    thread_local Population<T, F> tmp;
+  template <typename Pop, typename Rng, typename S = SelectionFunc>
+  typename std::enable_if<
+      HasSelectionPlan<S, FitnessView<FitnessType<Pop>>, Rng>::value>::type
+  Plan(const Pop& src, std::vector<size_t>& dst, Rng& rng) {
+    thread_local FitnessView<FitnessType<Pop>> view;
 
-    tmp = src;
-    if (tmp.empty()) {
+    if (src.empty()) {
       return;
     }
 
-    F mean_fitness = 0.0;
-    for (const auto& it : src) {
-      mean_fitness += it.fitness;
+    Scale(src, view);
+    selection.Plan(view, dst, rng);
+  }
+
+  template <typename Pop, typename Rng>
+  void operator()(Pop& src, Pop& dst, Rng& rng) {
+    if (src.empty()) {
+      return;
     }
-    mean_fitness /= src.size();
 
-    F std_dev = 0.0;
-    for (const auto& it : src) {
-      F diff = it.fitness - mean_fitness;
-      std_dev += diff * diff;
+    Select(src, dst, rng,
+           std::integral_constant<bool, HasSelectionPlan<
+               SelectionFunc, FitnessView<FitnessType<Pop>>, Rng>::value>());
+  }
+
+ private:
+  // Copy the scaled fitness of the individuals to `view`.
+  template <typename Pop>
+  void Scale(const Pop& src, FitnessView<FitnessType<Pop>>& view) {
+    using F = FitnessType<Pop>;
+
+    PopulationStats<F> stats = ComputeStats(src);
+    F std_dev = stats.std_dev();
+
+    ViewFitness(src, view);
+    for (auto& it : view) {
+      it.fitness = fitness(it.fitness, stats.mean, std_dev);
     }
-    std_dev = std::sqrt(std_dev / src.size());
+  }
+
+  template <typename Pop, typename Rng>
+  void Select(Pop& src, Pop& dst, Rng& rng, std::true_type) {
+    thread_local std::vector<size_t> plan;
+
+    plan.clear();
+    Plan(src, plan, rng);
+    Gather(src, plan, dst);
+  }
+
+  template <typename Pop, typename Rng>
+  void Select(Pop& src, Pop& dst, Rng& rng, std::false_type) {
+    thread_local FitnessView<FitnessType<Pop>> view;
+    thread_local Pop tmp;
 
-    for (auto& it : tmp) {
-      it.fitness = fitness(it.fitness, mean_fitness, std_dev);
+    Scale(src, view);
+    tmp = src;
+    for (size_t i = 0; i < tmp.size(); ++i) {
+      tmp[i].fitness = view[i].fitness;
     }
 
+    size_t size = dst.size();
     selection(tmp, dst, rng);
+    for (size_t i = size; i < dst.size(); ++i) {
+      dst[i].mark_dirty();
+    }
   }
 };
 
@@ -0,0 +1,143 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_STATS_H_
+#define METASINF_INCLUDE_METASINF_STATS_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "metasinf/population.h"
+#include "metasinf/population_matrix.h"
+
+namespace snf {
+
+/// Summary statistics of the fitness of a population.
+template <typename F>
+struct PopulationStats {
+  PopulationStats()
+      : count(0), sum(0), mean(0), variance(0), min(0), max(0), argmax(0) {}
+
+  /// Number of individuals.
+  size_t count;
+
+  /// Sum of the fitness values.
+  F sum;
+
+  /// Mean fitness.
+  F mean;
+
+  /// Population variance of the fitness.
+  F variance;
+
+  /// Minimum fitness.
+  F min;
+
+  /// Maximum fitness.
+  F max;
+
+  /// Index of the first individual with the maximum fitness.
+  size_t argmax;
+
+  /// Return the standard deviation of the fitness.
+  F std_dev() const { return std::sqrt(variance); }
+};
+
+/// Compute the statistics of the `count` fitness values returned by
+/// `fitness(i)` in one pass.
+///
+/// The values are accumulated in independent lanes, which breaks the
+/// dependency chains of the sums and lets the compiler vectorize the loop
+/// when the values are contiguous. The sums are taken relative to the first
+/// value, so the variance stays accurate when the fitness values are large
+/// compared to their spread. Every lane keeps the first index of its
+/// maximum, and ties between lanes go to the lower index.
+template <typename F, typename FitnessFunc>
+PopulationStats<F> ComputeStats(size_t count, FitnessFunc fitness) {
+  enum : size_t { kLanes = 8 };
+
+  PopulationStats<F> stats;
+  stats.count = count;
+  if (count == 0) {
+    return stats;
+  }
+
+  F shift = fitness(0);
+  F sum[kLanes], squares[kLanes], min[kLanes], max[kLanes];
+  size_t argmax[kLanes];
+  for (size_t j = 0; j < kLanes; ++j) {
+    sum[j] = 0;
+    squares[j] = 0;
+    min[j] = shift;
+    max[j] = shift;
+    argmax[j] = 0;
+  }
+
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    for (size_t j = 0; j < kLanes; ++j) {
+      F value = fitness(i + j);
+      F diff = value - shift;
+      sum[j] += diff;
+      squares[j] += diff * diff;
+      min[j] = value < min[j] ? value : min[j];
+      argmax[j] = value > max[j] ? i + j : argmax[j];
+      max[j] = value > max[j] ? value : max[j];
+    }
+  }
+
+  for (; i < count; ++i) {
+    F value = fitness(i);
+    F diff = value - shift;
+    sum[0] += diff;
+    squares[0] += diff * diff;
+    min[0] = value < min[0] ? value : min[0];
+    argmax[0] = value > max[0] ? i : argmax[0];
+    max[0] = value > max[0] ? value : max[0];
+  }
+
+  for (size_t j = 1; j < kLanes; ++j) {
+    sum[0] += sum[j];
+    squares[0] += squares[j];
+    min[0] = std::min(min[0], min[j]);
+    if (max[j] > max[0] || (max[j] == max[0] && argmax[j] < argmax[0])) {
+      max[0] = max[j];
+      argmax[0] = argmax[j];
+    }
+  }
+
+  F mean_diff = sum[0] / count;
+  stats.sum = sum[0] + shift * count;
+  stats.mean = mean_diff + shift;
+  stats.variance = std::max<F>(squares[0] / count - mean_diff * mean_diff, 0);
+  stats.min = min[0];
+  stats.max = max[0];
+  stats.argmax = argmax[0];
+
+  return stats;
+}
+
+/// Compute the statistics of `count` contiguous fitness values.
+template <typename F>
+PopulationStats<F> ComputeStats(const F* fitness, size_t count) {
+  return ComputeStats<F>(count,
+                         [fitness](size_t index) { return fitness[index]; });
+}
+
+/// Compute the fitness statistics of a population.
+template <typename Pop>
+PopulationStats<FitnessType<Pop>> ComputeStats(const Pop& pop) {
+  return ComputeStats<FitnessType<Pop>>(
+      pop.size(), [&pop](size_t index) { return pop[index].fitness; });
+}
+
+/// Compute the fitness statistics of a population, straight from its
+/// fitness column.
+template <typename E, typename F>
+PopulationStats<F> ComputeStats(const PopulationMatrix<E, F>& pop) {
+  return ComputeStats(pop.fitness(), pop.size());
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_STATS_H_
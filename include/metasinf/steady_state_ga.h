@@ -0,0 +1,336 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_STEADY_STATE_GA_H_
+#define METASINF_INCLUDE_METASINF_STEADY_STATE_GA_H_
+
+#include <cassert>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/delta.h"
+#include "metasinf/fitness_index.h"
+#include "metasinf/population.h"
+
+namespace snf {
+
+/// Choose the worst individual as the victim.
+struct VictimWorst {
+  template <typename Pop, typename Rng>
+  size_t operator()(const Pop& pop, Rng& rng) {
+    size_t worst = 0;
+    for (size_t i = 1; i < pop.size(); ++i) {
+      if (pop[i].fitness < pop[worst].fitness) {
+        worst = i;
+      }
+    }
+
+    return worst;
+  }
+
+  template <typename Pop, typename F, typename Rng>
+  size_t operator()(const Pop& pop, const FitnessIndex<F>& index, Rng& rng) {
+    return index.worst();
+  }
+};
+
+/// Choose the victim uniformly at random.
+struct VictimRandom {
+  template <typename Pop, typename Rng>
+  size_t operator()(const Pop& pop, Rng& rng) {
+    std::uniform_int_distribution<size_t> dist(0, pop.size() - 1);
+    return dist(rng);
+  }
+};
+
+/// Choose the worst individual of a random tournament as the victim.
+struct VictimTournament {
+  explicit VictimTournament(int tournament_size)
+      : tournament_size(tournament_size) {}
+
+  /// Size of each tournament.
+  int tournament_size;
+
+  template <typename Pop, typename Rng>
+  size_t operator()(const Pop& pop, Rng& rng) {
+    assert(tournament_size > 0);
+
+    std::uniform_int_distribution<size_t> dist(0, pop.size() - 1);
+    size_t worst = dist(rng);
+    for (int i = 0; i < tournament_size - 1; ++i) {
+      size_t index = dist(rng);
+      if (pop[index].fitness < pop[worst].fitness) {
+        worst = index;
+      }
+    }
+
+    return worst;
+  }
+};
+
+/// Steady-state genetic algorithm.
+///
+/// Every step breeds `offspring_count` children and writes each of them over
+/// a victim chosen by the victim functor, directly in the population. With
+/// an offspring count of one this is the (mu + 1) scheme. Only the parents
+/// of the children are copied; the child buffer is reused across steps and
+/// victims are exchanged with the children instead of being copied over.
+///
+/// Parents are drawn one at a time if the selection functor provides
+/// `Draw`, e.g. `SelectionTournament` and `SelectionRandom`, which costs
+/// nothing per step that grows with the population. Other selection
+/// functors must provide a selection plan, which is computed over the whole
+/// population in every step.
+///
+/// The termination functor is checked after every step, so
+/// `TerminationGeneration` counts steps.
+template <
+    typename EvaluationFunc,
+    typename SelectionFunc,
+    typename CrossoverFunc,
+    typename MutationFunc,
+    typename VictimFunc,
+    typename TerminationFunc>
+struct SteadyStateGa {
+  /// Construct a new simulation.
+  SteadyStateGa(size_t offspring_count, double mutation_rate,
+                double crossover_rate,
+                const EvaluationFunc& evaluation = EvaluationFunc(),
+                const SelectionFunc& selection = SelectionFunc(),
+                const CrossoverFunc& crossover = CrossoverFunc(),
+                const MutationFunc& mutation = MutationFunc(),
+                const VictimFunc& victim = VictimFunc(),
+                const TerminationFunc& termination = TerminationFunc())
+      : offspring_count(offspring_count),
+        mutation_rate(mutation_rate),
+        crossover_rate(crossover_rate),
+        evaluation(evaluation),
+        selection(selection),
+        crossover(crossover),
+        mutation(mutation),
+        victim(victim),
+        termination(termination),
+        indexed_(nullptr) {}
+
+  /// Number of children bred in every step.
+  size_t offspring_count;
+
+  /// Mutation rate.
+  double mutation_rate;
+
+  /// Crossover rate.
+  double crossover_rate;
+
+  /// Evaluation functor.
+  EvaluationFunc evaluation;
+
+  /// Selection functor. Must provide `Draw` or a selection plan.
+  SelectionFunc selection;
+
+  /// Crossover functor.
+  CrossoverFunc crossover;
+
+  /// Mutation functor.
+  MutationFunc mutation;
+
+  /// Victim functor, which returns the index of the individual to replace.
+  VictimFunc victim;
+
+  /// Termination functor.
+  TerminationFunc termination;
+
+  /// Perform the next evolution step.
+  ///
+  /// The dirty individuals are evaluated first, which scans the population.
+  /// The fitness index is kept between steps, and rebuilt when the engine
+  /// is given another population, one of another size, or one that had
+  /// dirty individuals; otherwise the population must only be changed by
+  /// the engine between steps.
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
+    if (pop.empty()) {
+      return true;
+    }
+
+    bool evaluated = Evaluate(pop, evaluation, rng) > 0;
+    if (UsesIndex<Pop, Rng>::value &&
+        (evaluated || indexed_ != &pop || index_.size() != pop.size())) {
+      BuildIndex(pop);
+    }
+
+    return Step(pop, rng);
+  }
+
+  /// Run the algorithm until the termination conditions have been met.
+  ///
+  /// Only the algorithm modifies the population while it runs, so the
+  /// population is evaluated and the fitness index built once, and then
+  /// updated with every replaced victim. `VictimWorst`,
+  /// `TerminationFitness` and `TerminationStagnation` query the index in
+  /// O(log n) time, so with a selection functor that provides `Draw` a step
+  /// takes O(log n) time besides breeding and evaluating the offspring.
+  template <typename Pop, typename Rng>
+  void Run(Pop& pop, Rng& rng) {
+    if (pop.empty()) {
+      return;
+    }
+
+    Evaluate(pop, evaluation, rng);
+    if (UsesIndex<Pop, Rng>::value) {
+      BuildIndex(pop);
+    }
+
+    while (!Step(pop, rng)) {}
+  }
+
+  /// Write the rates and the termination state to a checkpoint.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(mutation_rate);
+    writer.Write(crossover_rate);
+    writer.Write(termination);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(mutation_rate);
+    reader.Read(crossover_rate);
+    reader.Read(termination);
+  }
+
+ private:
+  // Fitness index over the population, with the fitness values converted
+  // to `double`, and the population it indexes.
+  FitnessIndex<double> index_;
+  const void* indexed_;
+
+  // Whether the victim or the termination functor queries the index.
+  template <typename Pop, typename Rng>
+  using UsesIndex = std::integral_constant<
+      bool,
+      AcceptsFitnessIndex<VictimFunc, Pop, double, Rng>::value ||
+          AcceptsFitnessIndex<TerminationFunc, Pop, double, Rng>::value>;
+
+  template <typename Pop>
+  void BuildIndex(const Pop& pop) {
+    index_.Build(pop);
+    indexed_ = &pop;
+  }
+
+  // Append `count` parents to `plan`, drawn one at a time. Always succeeds.
+  template <typename Pop, typename Rng>
+  bool SelectParents(const Pop& pop, size_t count, std::vector<size_t>& plan,
+                     Rng& rng, std::true_type) {
+    for (size_t i = 0; i < count; ++i) {
+      plan.push_back(selection.Draw(pop, rng));
+    }
+
+    return true;
+  }
+
+  // Append at least `count` parents to `plan`, the first `count` of which
+  // are drawn at random from the selection plans. Returns false if the
+  // selection functor selects no individuals.
+  template <typename Pop, typename Rng>
+  bool SelectParents(const Pop& pop, size_t count, std::vector<size_t>& plan,
+                     Rng& rng, std::false_type) {
+    static_assert(HasSelectionPlan<SelectionFunc, Pop, Rng>::value,
+                  "The selection functor must provide Draw or a selection "
+                  "plan");
+
+    while (plan.size() < count) {
+      size_t size = plan.size();
+      selection.Plan(pop, plan, rng);
+      if (plan.size() == size) {
+        return false;
+      }
+    }
+
+    // Plans may list the selected individuals in index or fitness order.
+    for (size_t i = 0; i < count; ++i) {
+      std::uniform_int_distribution<size_t> dist(i, plan.size() - 1);
+      std::swap(plan[i], plan[dist(rng)]);
+    }
+
+    return true;
+  }
+
+  // Breed and insert the offspring into an evaluated population, keeping
+  // the index up to date if it is used.
+  template <typename Pop, typename Rng>
+  bool Step(Pop& pop, Rng& rng) {
+    thread_local std::vector<size_t> plan;
+    thread_local Pop children;
+
+    assert(offspring_count > 0);
+    assert(mutation_rate >= 0.0 && mutation_rate <= 1.0);
+    assert(crossover_rate >= 0.0 && crossover_rate <= 1.0);
+
+    // Parents are bred in pairs; the second child of an odd count is
+    // discarded.
+    size_t parent_count = offspring_count + offspring_count % 2;
+    plan.clear();
+    if (!SelectParents(pop, parent_count, plan, rng,
+                       std::integral_constant<bool, HasSelectionDraw<
+                           SelectionFunc, Pop, Rng>::value>())) {
+      return false;
+    }
+
+    ResizeLike(children, pop, parent_count);
+    for (size_t i = 0; i < parent_count; ++i) {
+      CopyIndividual(pop, plan[i], children, i);
+    }
+
+    std::bernoulli_distribution mutation_dist(mutation_rate);
+    std::bernoulli_distribution crossover_dist(crossover_rate);
+    for (size_t i = 0; i < parent_count / 2; ++i) {
+      auto&& child0 = children[2 * i + 0];
+      auto&& child1 = children[2 * i + 1];
+
+      if (crossover_dist(rng)) {
+        crossover(child0.data, child1.data, rng);
+        child0.mark_dirty();
+        child1.mark_dirty();
+      }
+
+      if (mutation_dist(rng)) {
+        Mutate(mutation, evaluation, child0, rng);
+      }
+
+      if (mutation_dist(rng)) {
+        Mutate(mutation, evaluation, child1, rng);
+      }
+    }
+
+    // The discarded child is reset to its evaluated parent rather than
+    // dropped, so that the children keep their storage between steps.
+    if (offspring_count < parent_count) {
+      CopyIndividual(pop, plan[offspring_count], children, offspring_count);
+    }
+
+    Evaluate(children, evaluation, rng);
+    for (size_t i = 0; i < offspring_count; ++i) {
+      size_t target = CallIndexed(victim, pop, index_, rng);
+      SwapIndividuals(children, i, pop, target);
+      if (UsesIndex<Pop, Rng>::value) {
+        index_.Update(target, pop[target].fitness);
+      }
+    }
+
+    return CallIndexed(termination, pop, index_, rng);
+  }
+};
+
+template <typename... Args>
+SteadyStateGa<Args...> make_steady_state_ga(size_t offspring_count,
+                                            double mutation_rate,
+                                            double crossover_rate,
+                                            Args... args) {
+  return {offspring_count, mutation_rate, crossover_rate, args...};
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_STEADY_STATE_GA_H_
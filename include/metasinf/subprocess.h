@@ -0,0 +1,677 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#ifndef METASINF_INCLUDE_METASINF_SUBPROCESS_H_
+#define METASINF_INCLUDE_METASINF_SUBPROCESS_H_
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metasinf/population.h"
+
+extern char** environ;
+
+namespace snf {
+
+/// Write the bytes of a trivially copyable genome to `dst`.
+///
+/// Genomes are transferred to worker processes through shared memory. The
+/// encoder returns the number of bytes written, or `capacity + 1` if the
+/// genome does not fit. Other genome types can be supported by overloading
+/// `EncodeGenome` and `DecodeGenome` in the namespace of the genome.
+template <typename T>
+typename std::enable_if<std::is_trivially_copyable<T>::value, size_t>::type
+EncodeGenome(const T& value, void* dst, size_t capacity) {
+  if (sizeof(T) > capacity) {
+    return capacity + 1;
+  }
+
+  std::memcpy(dst, &value, sizeof(T));
+  return sizeof(T);
+}
+
+/// Write the elements of a contiguous container genome to `dst`.
+template <typename T>
+typename std::enable_if<
+    !std::is_trivially_copyable<T>::value &&
+        std::is_trivially_copyable<typename T::value_type>::value &&
+        std::is_pointer<decltype(std::declval<const T&>().data())>::value,
+    size_t>::type
+EncodeGenome(const T& value, void* dst, size_t capacity) {
+  size_t size = value.size() * sizeof(typename T::value_type);
+  if (size > capacity) {
+    return capacity + 1;
+  }
+
+  std::memcpy(dst, value.data(), size);
+  return size;
+}
+
+/// Read a trivially copyable genome from `src`.
+template <typename T>
+typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+DecodeGenome(const void* src, size_t size, T& value) {
+  assert(size == sizeof(T));
+  std::memcpy(&value, src, sizeof(T));
+}
+
+/// Read a contiguous container genome from `src`.
+template <typename T>
+typename std::enable_if<
+    !std::is_trivially_copyable<T>::value &&
+    std::is_trivially_copyable<typename T::value_type>::value &&
+    std::is_pointer<decltype(std::declval<T&>().data())>::value>::type
+DecodeGenome(const void* src, size_t size, T& value) {
+  assert(size % sizeof(typename T::value_type) == 0);
+  value.resize(size / sizeof(typename T::value_type));
+  std::memcpy(value.data(), src, size);
+}
+
+/// Layout of the shared memory region of a subprocess worker.
+///
+/// The region starts with a header, followed by a ring of `slot_count`
+/// slots. Every slot holds a request header, the fitness value and up to
+/// `slot_size` bytes of genome data.
+struct SubprocessLayout {
+  enum : uint32_t { kMagic = 0x736e6631, kVersion = 1 };
+
+  /// Descriptors inherited by the worker processes.
+  enum : int { kMemoryFd = 3, kSocketFd = 4 };
+
+  enum : size_t { kAlignment = 64, kFitnessBytes = 16 };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t slot_count;
+    uint64_t slot_size;
+    uint64_t slot_stride;
+  };
+
+  struct Slot {
+    uint64_t seed;
+    uint64_t size;
+    uint64_t fitness_size;
+    unsigned char fitness[kFitnessBytes];
+  };
+
+  static size_t HeaderSize() { return RoundUp(sizeof(Header)); }
+
+  static size_t DataOffset() { return RoundUp(sizeof(Slot)); }
+
+  static size_t SlotStride(size_t slot_size) {
+    return RoundUp(DataOffset() + slot_size);
+  }
+
+ private:
+  static size_t RoundUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+};
+
+/// Pool of worker processes that evaluate genomes out of process.
+///
+/// Each worker runs the specified command, which must call
+/// `RunSubprocessWorker` when `IsSubprocessWorker()` is true. Every worker
+/// owns a shared memory ring of `queue_depth` slots; genomes are encoded
+/// straight into the slots and the fitness is read back from them, while a
+/// socket only carries slot indices. Workers that crash, or exceed the
+/// timeout while evaluating a genome, are killed and restarted. The affected
+/// genome is retried up to `max_retries` times before it is assigned the
+/// failure fitness. Workers that cannot be started are left idle; if no
+/// worker can be started, or polling fails, the genomes are assigned the
+/// failure fitness. Only POSIX systems are supported.
+struct SubprocessPool {
+  /// Launch `worker_count` workers running `command`. Genomes are limited to
+  /// `slot_size` encoded bytes. A zero `timeout` disables the timeouts.
+  SubprocessPool(const std::vector<std::string>& command, size_t worker_count,
+                 size_t slot_size,
+                 std::chrono::milliseconds timeout =
+                     std::chrono::milliseconds(0),
+                 size_t queue_depth = 2)
+      : max_retries(1),
+        command_(command),
+        slot_size_(slot_size),
+        queue_depth_(queue_depth),
+        timeout_(timeout),
+        restarts_(0),
+        timeouts_(0) {
+    assert(!command.empty());
+    assert(worker_count > 0 && queue_depth > 0);
+    workers_.resize(worker_count);
+    for (auto& worker : workers_) {
+      if (Map(worker)) {
+        Launch(worker);
+      }
+    }
+  }
+
+  SubprocessPool(const SubprocessPool&) = delete;
+  SubprocessPool& operator=(const SubprocessPool&) = delete;
+
+  ~SubprocessPool() {
+    for (auto& worker : workers_) {
+      Stop(worker, false);
+      if (worker.memory != nullptr) {
+        munmap(worker.memory, worker.memory_size);
+      }
+
+      if (worker.memory_fd >= 0) {
+        close(worker.memory_fd);
+      }
+    }
+  }
+
+  /// Number of times a failed genome is evaluated again.
+  size_t max_retries;
+
+  /// Return the number of workers.
+  size_t concurrency() const { return workers_.size(); }
+
+  /// Return the number of worker restarts.
+  uint64_t restarts() const { return restarts_; }
+
+  /// Return the number of evaluations that exceeded the timeout.
+  uint64_t timeouts() const { return timeouts_; }
+
+  /// Evaluate the genomes on the workers. Genomes whose evaluation keeps
+  /// failing are assigned `failure_fitness`.
+  template <typename T, typename F, typename Rng>
+  void Evaluate(Span<T> data, Span<F> fitness, F failure_fitness, Rng& rng) {
+    static_assert(std::is_trivially_copyable<F>::value &&
+                      sizeof(F) <= SubprocessLayout::kFitnessBytes,
+                  "Unsupported fitness type");
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::deque<size_t> queue;
+    std::vector<size_t> retries(data.size(), 0);
+    for (size_t i = 0; i < data.size(); ++i) {
+      queue.push_back(i);
+    }
+
+    size_t remaining = data.size();
+    std::vector<pollfd> fds(workers_.size());
+    while (remaining > 0) {
+      bool busy = false;
+      for (auto& worker : workers_) {
+        if (!queue.empty() && worker.pending.empty() && !IsAlive(worker)) {
+          Stop(worker, false);
+          if (!Launch(worker)) {
+            continue;
+          }
+
+          ++restarts_;
+        }
+
+        while (!queue.empty() && worker.pending.size() < queue_depth_) {
+          size_t index = queue.front();
+          queue.pop_front();
+          if (!Dispatch(worker, data[index], index, rng())) {
+            fitness[index] = failure_fitness;
+            --remaining;
+          }
+        }
+
+        busy = busy || !worker.pending.empty();
+      }
+
+      // No worker could be started.
+      if (!busy) {
+        Fail(queue, fitness, failure_fitness);
+        break;
+      }
+
+      Clock::time_point now = Clock::now();
+      int wait = -1;
+      for (size_t i = 0; i < workers_.size(); ++i) {
+        fds[i].fd = workers_[i].pending.empty() ? -1 : workers_[i].socket;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+        if (timeout_.count() > 0 && !workers_[i].pending.empty()) {
+          auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+              workers_[i].started + timeout_ - now).count();
+          left = std::max<decltype(left)>(left, 0) + 1;
+          wait = wait < 0 ? static_cast<int>(left)
+                          : std::min(wait, static_cast<int>(left));
+        }
+      }
+
+      if (poll(fds.data(), fds.size(), wait) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        // The requests in flight cannot be waited for, so their workers are
+        // restarted.
+        for (auto& worker : workers_) {
+          if (!worker.pending.empty()) {
+            Fail(worker.pending, fitness, failure_fitness);
+            Stop(worker, true);
+            Launch(worker);
+          }
+        }
+
+        Fail(queue, fitness, failure_fitness);
+        break;
+      }
+
+      now = Clock::now();
+      for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = workers_[i];
+        if (worker.pending.empty()) {
+          continue;
+        }
+
+        bool failed = false;
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+          failed = !Receive(worker, fitness, now, remaining);
+        } else if (timeout_.count() > 0 && now - worker.started >= timeout_) {
+          ++timeouts_;
+          failed = true;
+        }
+
+        if (!failed) {
+          continue;
+        }
+
+        // The head request caused the failure; the others are innocent and
+        // are requeued as they are.
+        size_t head = worker.pending.front();
+        for (size_t j = worker.pending.size(); j > 1; --j) {
+          queue.push_front(worker.pending[j - 1]);
+        }
+
+        if (retries[head]++ < max_retries) {
+          queue.push_front(head);
+        } else {
+          fitness[head] = failure_fitness;
+          --remaining;
+        }
+
+        Stop(worker, true);
+        if (Launch(worker)) {
+          ++restarts_;
+        }
+      }
+    }
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Worker {
+    Worker()
+        : pid(-1),
+          socket(-1),
+          memory_fd(-1),
+          memory(nullptr),
+          memory_size(0),
+          head(0) {}
+
+    pid_t pid;
+    int socket;
+    int memory_fd;
+    char* memory;
+    size_t memory_size;
+    size_t head;
+    std::deque<size_t> pending;
+    Clock::time_point started;
+  };
+
+  static void SetCloseOnExec(int fd) {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+  }
+
+  char* Slot(Worker& worker, size_t index) {
+    return worker.memory + SubprocessLayout::HeaderSize() +
+           index * SubprocessLayout::SlotStride(slot_size_);
+  }
+
+  // Assign the failure fitness to the queued genomes.
+  template <typename F>
+  static void Fail(std::deque<size_t>& queue, Span<F> fitness,
+                   F failure_fitness) {
+    for (size_t index : queue) {
+      fitness[index] = failure_fitness;
+    }
+
+    queue.clear();
+  }
+
+  // Create the shared memory region of a worker. Returns false on failure,
+  // leaving the worker unmapped.
+  bool Map(Worker& worker) {
+    static std::atomic<unsigned> counter(0);
+    std::string name = "/snf-" + std::to_string(getpid()) + "-" +
+                       std::to_string(counter++);
+    worker.memory_fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (worker.memory_fd < 0) {
+      return false;
+    }
+
+    shm_unlink(name.c_str());
+    SetCloseOnExec(worker.memory_fd);
+
+    size_t stride = SubprocessLayout::SlotStride(slot_size_);
+    worker.memory_size = SubprocessLayout::HeaderSize() + queue_depth_ * stride;
+    void* memory = MAP_FAILED;
+    if (ftruncate(worker.memory_fd, worker.memory_size) == 0) {
+      memory = mmap(nullptr, worker.memory_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, worker.memory_fd, 0);
+    }
+
+    if (memory == MAP_FAILED) {
+      close(worker.memory_fd);
+      worker.memory_fd = -1;
+      return false;
+    }
+
+    worker.memory = static_cast<char*>(memory);
+
+    SubprocessLayout::Header header;
+    header.magic = SubprocessLayout::kMagic;
+    header.version = SubprocessLayout::kVersion;
+    header.slot_count = queue_depth_;
+    header.slot_size = slot_size_;
+    header.slot_stride = SubprocessLayout::SlotStride(slot_size_);
+    std::memcpy(worker.memory, &header, sizeof(header));
+    return true;
+  }
+
+  // Start the process of a mapped worker. Returns false on failure, leaving
+  // the worker stopped.
+  bool Launch(Worker& worker) {
+    int sockets[2];
+    if (worker.memory == nullptr ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+      return false;
+    }
+
+    SetCloseOnExec(sockets[0]);
+    SetCloseOnExec(sockets[1]);
+
+    // Everything the child needs is prepared before forking, since only
+    // async-signal-safe functions may be called between fork and exec.
+    std::vector<char*> argv;
+    for (auto& it : command_) {
+      argv.push_back(const_cast<char*>(it.c_str()));
+    }
+
+    argv.push_back(nullptr);
+
+    static char marker[] = "SNF_SUBPROCESS_WORKER=1";
+    std::vector<char*> envp;
+    for (char** it = environ; *it != nullptr; ++it) {
+      envp.push_back(*it);
+    }
+
+    envp.push_back(marker);
+    envp.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(sockets[0]);
+      close(sockets[1]);
+      return false;
+    }
+
+    if (pid == 0) {
+      int memory_fd = fcntl(worker.memory_fd, F_DUPFD, 16);
+      int socket = fcntl(sockets[1], F_DUPFD, 16);
+      if (memory_fd < 0 || socket < 0 ||
+          dup2(memory_fd, SubprocessLayout::kMemoryFd) < 0 ||
+          dup2(socket, SubprocessLayout::kSocketFd) < 0) {
+        _exit(127);
+      }
+
+      execve(argv[0], argv.data(), envp.data());
+      _exit(127);
+    }
+
+    close(sockets[1]);
+    worker.pid = pid;
+    worker.socket = sockets[0];
+    worker.head = 0;
+    worker.pending.clear();
+    return true;
+  }
+
+  void Stop(Worker& worker, bool force) {
+    if (force && worker.pid >= 0) {
+      kill(worker.pid, SIGKILL);
+    }
+
+    if (worker.socket >= 0) {
+      close(worker.socket);
+    }
+
+    if (worker.pid >= 0) {
+      while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+
+    worker.pid = -1;
+    worker.socket = -1;
+  }
+
+  // Reap an idle worker that has exited, so that it is restarted before it
+  // receives a request.
+  bool IsAlive(Worker& worker) {
+    if (worker.pid >= 0 && waitpid(worker.pid, nullptr, WNOHANG) == 0) {
+      return true;
+    }
+
+    worker.pid = -1;
+    return false;
+  }
+
+  template <typename T>
+  bool Dispatch(Worker& worker, const T& data, size_t index, uint64_t seed) {
+    size_t slot_index = (worker.head + worker.pending.size()) % queue_depth_;
+    char* slot = Slot(worker, slot_index);
+    size_t size = EncodeGenome(data, slot + SubprocessLayout::DataOffset(),
+                               slot_size_);
+    if (size > slot_size_) {
+      return false;
+    }
+
+    SubprocessLayout::Slot header = SubprocessLayout::Slot();
+    header.seed = seed;
+    header.size = size;
+    header.fitness_size = 0;
+    std::memcpy(slot, &header, sizeof(header));
+
+    uint32_t message = static_cast<uint32_t>(slot_index);
+    if (worker.pending.empty()) {
+      worker.started = Clock::now();
+    }
+
+    worker.pending.push_back(index);
+
+    // A failed send means that the worker has exited; the failure is
+    // detected by the next poll.
+    send(worker.socket, &message, sizeof(message), MSG_NOSIGNAL);
+    return true;
+  }
+
+  template <typename F>
+  bool Receive(Worker& worker, Span<F> fitness, Clock::time_point now,
+               size_t& remaining) {
+    uint32_t messages[16];
+    ssize_t count = recv(worker.socket, messages, sizeof(messages),
+                         MSG_DONTWAIT);
+    if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+      return true;
+    }
+
+    if (count <= 0 || count % sizeof(uint32_t) != 0) {
+      return false;
+    }
+
+    for (size_t i = 0; i < count / sizeof(uint32_t); ++i) {
+      if (messages[i] != worker.head || worker.pending.empty()) {
+        return false;
+      }
+
+      const char* slot = Slot(worker, worker.head);
+      SubprocessLayout::Slot header;
+      std::memcpy(&header, slot, sizeof(header));
+      if (header.fitness_size != sizeof(F)) {
+        return false;
+      }
+
+      std::memcpy(&fitness[worker.pending.front()], header.fitness,
+                  sizeof(F));
+      worker.pending.pop_front();
+      worker.head = (worker.head + 1) % queue_depth_;
+      worker.started = now;
+      --remaining;
+    }
+
+    return true;
+  }
+
+  std::vector<std::string> command_;
+  size_t slot_size_;
+  size_t queue_depth_;
+  std::chrono::milliseconds timeout_;
+  std::vector<Worker> workers_;
+  std::mutex mutex_;
+  uint64_t restarts_;
+  uint64_t timeouts_;
+};
+
+/// Evaluate individuals on the worker processes of a `SubprocessPool`.
+///
+/// Batches are spread over all the workers; single genomes are evaluated
+/// by the first idle worker. The random number generator passed to the
+/// evaluator only seeds the generators of the workers.
+struct EvaluationSubprocess {
+  explicit EvaluationSubprocess(SubprocessPool& pool,
+                                double failure_fitness = 0.0)
+      : pool(&pool), failure_fitness(failure_fitness) {}
+
+  /// Pool used to run the evaluations.
+  SubprocessPool* pool;
+
+  /// Fitness of the genomes whose evaluation keeps failing.
+  double failure_fitness;
+
+  template <typename T, typename Rng>
+  double operator()(T& data, Rng& rng) {
+    double fitness = -1.0;
+    pool->Evaluate(Span<T>(&data, 1), Span<double>(&fitness, 1),
+                   failure_fitness, rng);
+    return fitness;
+  }
+
+  template <typename T, typename F, typename Rng>
+  void operator()(Span<T> data, Span<F> fitness, Rng& rng) {
+    pool->Evaluate(data, fitness, static_cast<F>(failure_fitness), rng);
+  }
+};
+
+inline EvaluationSubprocess make_evaluation_subprocess(
+    SubprocessPool& pool, double failure_fitness = 0.0) {
+  return EvaluationSubprocess(pool, failure_fitness);
+}
+
+/// Return whether the process was launched by a `SubprocessPool`.
+inline bool IsSubprocessWorker() {
+  return std::getenv("SNF_SUBPROCESS_WORKER") != nullptr;
+}
+
+/// Serve evaluation requests from a `SubprocessPool` until it shuts down.
+///
+/// The evaluation functor receives the decoded genome and a random number
+/// generator seeded by the pool. Returns the process exit code.
+template <typename T, typename F, typename Rng = std::mt19937,
+          typename EvaluationFunc>
+int RunSubprocessWorker(EvaluationFunc func) {
+  static_assert(sizeof(F) <= SubprocessLayout::kFitnessBytes,
+                "Unsupported fitness type");
+
+  int memory_fd = SubprocessLayout::kMemoryFd;
+  int socket = SubprocessLayout::kSocketFd;
+
+  struct stat info;
+  if (fstat(memory_fd, &info) < 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(SubprocessLayout::Header)) {
+    return 1;
+  }
+
+  void* memory = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, memory_fd, 0);
+  if (memory == MAP_FAILED) {
+    return 1;
+  }
+
+  char* base = static_cast<char*>(memory);
+  SubprocessLayout::Header header;
+  std::memcpy(&header, base, sizeof(header));
+  if (header.magic != SubprocessLayout::kMagic ||
+      header.version != SubprocessLayout::kVersion) {
+    return 1;
+  }
+
+  T data;
+  for (;;) {
+    uint32_t message;
+    ssize_t count = recv(socket, &message, sizeof(message), MSG_WAITALL);
+    if (count != sizeof(message)) {
+      break;
+    }
+
+    if (message >= header.slot_count) {
+      return 1;
+    }
+
+    char* slot = base + SubprocessLayout::HeaderSize() +
+                 message * header.slot_stride;
+    SubprocessLayout::Slot request;
+    std::memcpy(&request, slot, sizeof(request));
+    DecodeGenome(slot + SubprocessLayout::DataOffset(), request.size, data);
+
+    std::seed_seq seq{static_cast<uint32_t>(request.seed),
+                      static_cast<uint32_t>(request.seed >> 32)};
+    Rng rng(seq);
+    F fitness = func(data, rng);
+
+    std::memcpy(request.fitness, &fitness, sizeof(F));
+    request.fitness_size = sizeof(F);
+    std::memcpy(slot, &request, sizeof(request));
+    if (send(socket, &message, sizeof(message), MSG_NOSIGNAL) !=
+        sizeof(message)) {
+      break;
+    }
+  }
+
+  munmap(memory, info.st_size);
+  return 0;
+}
+
+}  // namespace snf
+
+#endif  // METASINF_INCLUDE_METASINF_SUBPROCESS_H_
@@ -4,9 +4,13 @@
 #ifndef METASINF_INCLUDE_METASINF_TERMINATION_H_
 #define METASINF_INCLUDE_METASINF_TERMINATION_H_
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <tuple>
+#include <type_traits>
 
+#include "metasinf/fitness_index.h"
 #include "metasinf/population.h"
 
 namespace snf {
@@ -19,12 +23,24 @@ struct TerminationGeneration {
   /// Maximum number of generations.
   int max_generations;
 
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     ++curr_generation_;
     return curr_generation_ >= max_generations;
   }
 
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(max_generations);
+    writer.Write(curr_generation_);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(max_generations);
+    reader.Read(curr_generation_);
+  }
+
  private:
   int curr_generation_;
 };
@@ -38,8 +54,8 @@ struct TerminationFitness {
   /// Target fitness.
   F target_fitness;
 
-  template <typename T, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     auto best = std::max_element(pop.begin(), pop.end());
     if (best == pop.end()) {
       return true;
@@ -47,6 +63,15 @@ struct TerminationFitness {
 
     return best->fitness >= target_fitness;
   }
+
+  template <typename Pop, typename G, typename Rng>
+  bool operator()(Pop& pop, const FitnessIndex<G>& index, Rng& rng) {
+    if (index.empty()) {
+      return true;
+    }
+
+    return index.fitness(index.best()) >= target_fitness;
+  }
 };
 
 /// Terminate the simulation when the specified amount of time has elapsed.
@@ -58,12 +83,33 @@ struct TerminationTime {
   /// Maximum number of seconds.
   std::chrono::seconds max_time;
 
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     Clock::time_point now = Clock::now();
     return (now - start_time_) >= max_time;
   }
 
+  /// Save the elapsed time, which resumes counting when loaded.
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(static_cast<int64_t>(max_time.count()));
+    writer.Write(static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start_time_)
+            .count()));
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    int64_t max_seconds = 0;
+    int64_t elapsed = 0;
+    if (reader.Read(max_seconds) && reader.Read(elapsed)) {
+      max_time = std::chrono::seconds(max_seconds);
+      start_time_ = Clock::now() - std::chrono::duration_cast<Clock::duration>(
+                                       std::chrono::nanoseconds(elapsed));
+    }
+  }
+
  private:
   using Clock = std::chrono::high_resolution_clock;
   Clock::time_point start_time_;
@@ -80,26 +126,53 @@ struct TerminationStagnation {
   /// Maximum number of generations without improvement.
   int max_generations;
 
-  template <typename T, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     auto best = std::max_element(pop.begin(), pop.end());
     if (best == pop.end()) {
       return true;
     }
 
-    if (best->fitness > best_fitness_) {
-      best_fitness_ = best->fitness;
-      curr_generation_ = 0;
-      return false;
+    return Check(best->fitness);
+  }
+
+  template <typename Pop, typename G, typename Rng>
+  bool operator()(Pop& pop, const FitnessIndex<G>& index, Rng& rng) {
+    if (index.empty()) {
+      return true;
     }
 
-    ++curr_generation_;
-    return curr_generation_ >= max_generations;
+    return Check(index.fitness(index.best()));
+  }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    writer.Write(max_generations);
+    writer.Write(curr_generation_);
+    writer.Write(best_fitness_);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    reader.Read(max_generations);
+    reader.Read(curr_generation_);
+    reader.Read(best_fitness_);
   }
 
  private:
   int curr_generation_;
   F best_fitness_;
+
+  bool Check(F fitness) {
+    if (fitness > best_fitness_) {
+      best_fitness_ = fitness;
+      curr_generation_ = 0;
+      return false;
+    }
+
+    ++curr_generation_;
+    return curr_generation_ >= max_generations;
+  }
 };
 
 /// Terminate the simulation based on a flag.
@@ -109,12 +182,23 @@ struct TerminationFlag {
   /// Flag indicating whether to terminate the simulation.
   bool flag;
 
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     return flag;
   }
 };
 
+template <typename Func, typename Pop, typename Rng>
+bool CheckTermination(Func& func, Pop& pop, Rng& rng) {
+  return func(pop, rng);
+}
+
+template <typename Func, typename Pop, typename F, typename Rng>
+bool CheckTermination(Func& func, Pop& pop, const FitnessIndex<F>& index,
+                      Rng& rng) {
+  return CallIndexed(func, pop, index, rng);
+}
+
 /// Terminate the simulation when at least one of the specified termination
 /// conditions has been met.
 template <typename... Tp>
@@ -125,19 +209,57 @@ struct TerminationOr {
   std::tuple<Tp...> funcs;
 
   template <int I = 0, typename... Args>
-  typename std::enable_if<I == sizeof...(Tp), bool>::type Check(Args... args) {
+  typename std::enable_if<I == sizeof...(Tp), bool>::type Check(Args&... args) {
     return false;
   }
 
   template <int I = 0, typename... Args>
-  typename std::enable_if<I < sizeof...(Tp), bool>::type Check(Args... args) {
-    return std::get<I>(funcs)(args...) || Check<I + 1>(args...);
+  typename std::enable_if<I < sizeof...(Tp), bool>::type Check(Args&... args) {
+    return CheckTermination(std::get<I>(funcs), args...) ||
+           Check<I + 1>(args...);
   }
 
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     return Check(pop, rng);
   }
+
+  template <typename Pop, typename G, typename Rng>
+  bool operator()(Pop& pop, const FitnessIndex<G>& index, Rng& rng) {
+    return Check(pop, index, rng);
+  }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    SaveEach(writer);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    LoadEach(reader);
+  }
+
+ private:
+  template <int I = 0, typename Writer>
+  typename std::enable_if<I == sizeof...(Tp)>::type SaveEach(
+      Writer& writer) const {}
+
+  template <int I = 0, typename Writer>
+  typename std::enable_if<I < sizeof...(Tp)>::type SaveEach(
+      Writer& writer) const {
+    writer.Write(std::get<I>(funcs));
+    SaveEach<I + 1>(writer);
+  }
+
+  template <int I = 0, typename Reader>
+  typename std::enable_if<I == sizeof...(Tp)>::type LoadEach(
+      Reader& reader) {}
+
+  template <int I = 0, typename Reader>
+  typename std::enable_if<I < sizeof...(Tp)>::type LoadEach(Reader& reader) {
+    reader.Read(std::get<I>(funcs));
+    LoadEach<I + 1>(reader);
+  }
 };
 
 /// Terminate the simulation when all of the specified termination conditions
@@ -150,19 +272,57 @@ struct TerminationAnd {
   std::tuple<Tp...> funcs;
 
   template <int I = 0, typename... Args>
-  typename std::enable_if<I == sizeof...(Tp), bool>::type Check(Args... args) {
+  typename std::enable_if<I == sizeof...(Tp), bool>::type Check(Args&... args) {
     return true;
   }
 
   template <int I = 0, typename... Args>
-  typename std::enable_if<I < sizeof...(Tp), bool>::type Check(Args... args) {
-    return std::get<I>(funcs)(args...) && Check<I + 1>(args...);
+  typename std::enable_if<I < sizeof...(Tp), bool>::type Check(Args&... args) {
+    return CheckTermination(std::get<I>(funcs), args...) &&
+           Check<I + 1>(args...);
   }
 
-  template <typename T, typename F, typename Rng>
-  bool operator()(Population<T, F>& pop, Rng& rng) {
+  template <typename Pop, typename Rng>
+  bool operator()(Pop& pop, Rng& rng) {
     return Check(pop, rng);
   }
+
+  template <typename Pop, typename G, typename Rng>
+  bool operator()(Pop& pop, const FitnessIndex<G>& index, Rng& rng) {
+    return Check(pop, index, rng);
+  }
+
+  template <typename Writer>
+  void Save(Writer& writer) const {
+    SaveEach(writer);
+  }
+
+  template <typename Reader>
+  void Load(Reader& reader) {
+    LoadEach(reader);
+  }
+
+ private:
+  template <int I = 0, typename Writer>
+  typename std::enable_if<I == sizeof...(Tp)>::type SaveEach(
+      Writer& writer) const {}
+
+  template <int I = 0, typename Writer>
+  typename std::enable_if<I < sizeof...(Tp)>::type SaveEach(
+      Writer& writer) const {
+    writer.Write(std::get<I>(funcs));
+    SaveEach<I + 1>(writer);
+  }
+
+  template <int I = 0, typename Reader>
+  typename std::enable_if<I == sizeof...(Tp)>::type LoadEach(
+      Reader& reader) {}
+
+  template <int I = 0, typename Reader>
+  typename std::enable_if<I < sizeof...(Tp)>::type LoadEach(Reader& reader) {
+    reader.Read(std::get<I>(funcs));
+    LoadEach<I + 1>(reader);
+  }
 };
 
 }  // namespace snf
@@ -0,0 +1,72 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "metasinf/async_ga.h"
+#include "metasinf/crossover.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+using Rng = std::mt19937;
+
+// Maximize y = sin^6(4x) 0<x<1, with a variable evaluation latency.
+double f(double& value, Rng& rng) {
+  std::uniform_int_distribution<int> dist(0, 2000);
+  std::this_thread::sleep_for(std::chrono::microseconds(dist(rng)));
+  return std::pow(std::sin(4.0 * value), 6);
+}
+
+int main() {
+  Rng rng;
+  rng.seed(static_cast<unsigned int>(time(nullptr)));
+
+  auto ga = snf::make_async_ga(
+      4, 0.2, 0.8, f,
+      snf::SelectionTournament(snf::SelectionSize(0.4), 2),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementWorst(),
+      snf::TerminationGeneration(500));
+
+  snf::Population<double, double> pop(20);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    it.data = dist(rng);
+  }
+
+  ga.Run(pop, rng);
+
+  if (!pop.empty()) {
+    std::sort(pop.begin(), pop.end());
+
+    auto best = pop.back();
+    std::cout << best.data << " (Fitness: " << best.fitness << ")" << std::endl;
+  }
+
+  // A selection of one parent at a time is repeated until there are two,
+  // and a selection of none stops the run.
+  auto single = snf::make_async_ga(
+      2, 0.2, 0.8, f,
+      snf::SelectionTournament(snf::SelectionSize(size_t(1)), 2),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementWorst(),
+      snf::TerminationGeneration(20));
+  single.Run(pop, rng);
+
+  auto none = snf::make_async_ga(
+      2, 0.2, 0.8, f,
+      snf::SelectionTournament(snf::SelectionSize(0.0), 2),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementWorst(),
+      snf::TerminationGeneration(20));
+  none.Run(pop, rng);
+
+  return 0;
+}
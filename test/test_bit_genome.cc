@@ -0,0 +1,195 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metasinf/bit_genome.h"
+#include "metasinf/checkpoint.h"
+#include "metasinf/crossover.h"
+#include "metasinf/delta.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+static constexpr size_t kSize = 150;
+using Rng = std::mt19937;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+snf::BitGenome RandomGenome(size_t size, Rng& rng) {
+  std::bernoulli_distribution dist;
+  snf::BitGenome value(size);
+  for (size_t i = 0; i < size; ++i) {
+    value.set(i, dist(rng));
+  }
+
+  return value;
+}
+
+std::vector<bool> ToBits(const snf::BitGenome& value) {
+  std::vector<bool> bits(value.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    bits[i] = value[i];
+  }
+
+  return bits;
+}
+
+// Return whether the unused bits of the last word are zero.
+bool TailClear(const snf::BitGenome& value) {
+  return value.word_count() == 0 ||
+         (value.words()[value.word_count() - 1] & ~value.tail_mask()) == 0;
+}
+
+// Maximize the number of set bits.
+double f(snf::BitGenome& value, Rng& rng) {
+  return static_cast<double>(value.count());
+}
+
+int main() {
+  Rng rng(1);
+
+  // The word-level N-point crossover matches the element-wise one.
+  for (int points = 1; points <= 4; ++points) {
+    snf::BitGenome value0 = RandomGenome(kSize, rng);
+    snf::BitGenome value1 = RandomGenome(kSize, rng);
+    std::vector<bool> bits0 = ToBits(value0);
+    std::vector<bool> bits1 = ToBits(value1);
+
+    Rng rng0 = rng;
+    Rng rng1 = rng;
+    snf::CrossoverPoint crossover(points);
+    crossover(value0, value1, rng0);
+    crossover(bits0, bits1, rng1);
+    Check(ToBits(value0) == bits0 && ToBits(value1) == bits1,
+          "point crossover");
+    Check(TailClear(value0) && TailClear(value1), "point crossover tail");
+  }
+
+  // The uniform crossover only exchanges bits between the parents.
+  {
+    snf::BitGenome value0 = RandomGenome(kSize, rng);
+    snf::BitGenome value1 = RandomGenome(kSize, rng);
+    snf::BitGenome old0 = value0, old1 = value1;
+    snf::CrossoverUniform()(value0, value1, rng);
+    bool exchanged = true;
+    for (size_t i = 0; i < kSize; ++i) {
+      bool kept = value0[i] == old0[i] && value1[i] == old1[i];
+      bool swapped = value0[i] == old1[i] && value1[i] == old0[i];
+      exchanged = exchanged && (kept || swapped);
+    }
+
+    Check(exchanged && value0 != old0, "uniform crossover");
+    Check(TailClear(value0) && TailClear(value1), "uniform crossover tail");
+  }
+
+  // Sparse and dense flip mutations log every flipped bit.
+  for (double prob : {0.05, 0.5}) {
+    snf::BitGenome value = RandomGenome(kSize, rng);
+    snf::BitGenome old = value;
+    snf::MutationLog<bool> log;
+    snf::MutationFlip mutation(prob);
+    mutation(value, log, rng);
+
+    snf::BitGenome restored = value;
+    for (const auto& it : log) {
+      restored.set(it.first, it.second);
+    }
+
+    size_t flipped = 0;
+    for (size_t i = 0; i < kSize; ++i) {
+      flipped += value[i] != old[i];
+    }
+
+    Check(restored == old && flipped == log.size() && !log.empty(),
+          "flip mutation");
+    Check(TailClear(value), "flip mutation tail");
+  }
+
+  // A range swap exchanges exactly the bits in the range.
+  {
+    snf::BitGenome value0 = RandomGenome(kSize, rng);
+    snf::BitGenome value1 = RandomGenome(kSize, rng);
+    snf::BitGenome old0 = value0, old1 = value1;
+    snf::SwapBits(value0, value1, 5, 130);
+    bool swapped = true;
+    for (size_t i = 0; i < kSize; ++i) {
+      bool inside = i >= 5 && i < 130;
+      swapped = swapped && value0[i] == (inside ? old1[i] : old0[i]) &&
+                value1[i] == (inside ? old0[i] : old1[i]);
+    }
+
+    Check(swapped, "range swap");
+  }
+
+  // Encoding round trip, and malformed buffers.
+  {
+    snf::BitGenome value = RandomGenome(kSize, rng);
+    std::vector<char> buffer(64);
+    size_t size = snf::EncodeGenome(value, buffer.data(), buffer.size());
+    snf::BitGenome decoded;
+    snf::DecodeGenome(buffer.data(), size, decoded);
+    Check(size <= buffer.size() && decoded == value, "encoding");
+
+    snf::DecodeGenome(buffer.data(), size - 8, decoded);
+    Check(decoded.empty(), "truncated encoding");
+
+    uint64_t bits = 1000;
+    std::memcpy(buffer.data(), &bits, sizeof(bits));
+    snf::DecodeGenome(buffer.data(), size, decoded);
+    Check(decoded.empty(), "inconsistent encoding");
+  }
+
+  // Loading a checkpoint clears the unused bits.
+  {
+    std::string buffer;
+    snf::CheckpointWriter writer(buffer);
+    snf::SaveCheckpoint(writer, 1, uint64_t(3),
+                        std::vector<uint64_t>(1, ~uint64_t(0)));
+
+    snf::BitGenome value;
+    std::istringstream in(buffer);
+    Check(snf::LoadCheckpoint(in, 1, value) && value.size() == 3 &&
+              value.count() == 3 && TailClear(value),
+          "checkpoint tail");
+  }
+
+  // OneMax.
+  {
+    auto ga = snf::make_ga(
+        0.5, 0.8, f,
+        snf::SelectionTournament(snf::SelectionSize(0.5), 2),
+        snf::CrossoverUniform(),
+        snf::MutationFlip(1.0 / kSize),
+        snf::ReplacementElitist(snf::SelectionSize(0.5)),
+        snf::TerminationFitness<double>(kSize));
+
+    snf::Population<snf::BitGenome, double> pop(20);
+    for (auto& it : pop) {
+      it.data = RandomGenome(kSize, rng);
+    }
+
+    ga.Run(pop, rng);
+    std::sort(pop.begin(), pop.end());
+    std::cout << "OneMax: " << pop.back().fitness << std::endl;
+    Check(pop.back().fitness == kSize, "OneMax");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
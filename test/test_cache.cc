@@ -0,0 +1,148 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "metasinf/cache.h"
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/parallel.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+using Genome = std::array<int, 4>;
+using Rng = std::mt19937;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+double Sum(const Genome& value) {
+  double sum = 0.0;
+  for (int it : value) {
+    sum += it;
+  }
+
+  return sum;
+}
+
+// Sum the elements and count the evaluations. Thread-safe.
+struct Evaluation {
+  std::atomic<int>* count;
+
+  double operator()(Genome& value, Rng& rng) {
+    ++*count;
+    return Sum(value);
+  }
+};
+
+// Hash every genome to the same value.
+struct CollidingHash {
+  size_t operator()(const Genome& value) const { return 42; }
+};
+
+int main() {
+  Rng rng(1);
+  std::atomic<int> count(0);
+
+  // Duplicates within a batch are evaluated once, and cached genomes are
+  // not evaluated again.
+  {
+    snf::EvaluationCache<Genome, double, Evaluation> cache(
+        16, Evaluation{&count});
+    std::vector<Genome> data = {{{1, 2, 3, 4}}, {{0, 0, 0, 1}},
+                                {{1, 2, 3, 4}}, {{5, 5, 5, 5}}};
+    std::vector<double> fitness(data.size());
+    cache(snf::Span<Genome>(data.data(), data.size()),
+          snf::Span<double>(fitness.data(), fitness.size()), rng);
+    Check(count == 3 && cache.misses() == 3 && cache.hits() == 1,
+          "batch duplicates");
+    Check(fitness[0] == 10.0 && fitness[1] == 1.0 && fitness[2] == 10.0 &&
+              fitness[3] == 20.0,
+          "batch fitness");
+
+    Check(cache(data[3], rng) == 20.0 && count == 3 && cache.hits() == 2,
+          "cached genome");
+  }
+
+  // The CLOCK hand evicts the entries that were not referenced since it
+  // last passed.
+  {
+    count = 0;
+    snf::EvaluationCache<Genome, double, Evaluation> cache(
+        2, Evaluation{&count});
+    Genome a = {{1, 0, 0, 0}}, b = {{2, 0, 0, 0}}, c = {{3, 0, 0, 0}};
+    cache(a, rng);
+    cache(b, rng);
+    cache(a, rng);
+    cache(c, rng);
+    Check(cache.size() == 2 && count == 3, "capacity");
+
+    cache(a, rng);
+    Check(count == 3, "referenced entry kept");
+    cache(b, rng);
+    Check(count == 4, "unreferenced entry evicted");
+  }
+
+  // Hash collisions never return the fitness of another genome.
+  {
+    count = 0;
+    snf::EvaluationCache<Genome, double, Evaluation, CollidingHash> cache(
+        8, Evaluation{&count});
+    Genome a = {{1, 1, 1, 1}}, b = {{2, 2, 2, 2}};
+    Check(cache(a, rng) == 4.0 && cache(b, rng) == 8.0 &&
+              cache(a, rng) == 4.0,
+          "hash collision");
+  }
+
+  // The cache wraps the parallel evaluator, so only the misses of a batch
+  // are spread over the workers and the cache itself is only used by the
+  // calling thread.
+  {
+    count = 0;
+    snf::ThreadPool pool(4);
+    auto cache = snf::make_evaluation_cache<Genome, double>(
+        64, snf::make_evaluation_parallel(pool, Evaluation{&count}));
+
+    auto ga = snf::make_ga(
+        0.2, 0.8, cache,
+        snf::SelectionTournament(snf::SelectionSize(0.4), 2),
+        snf::CrossoverPoint(),
+        snf::MutationSwap(1),
+        snf::ReplacementElitist(snf::SelectionSize(0.6)),
+        snf::TerminationGeneration(50));
+
+    snf::Population<Genome, double> pop(20);
+    for (size_t i = 0; i < pop.size(); ++i) {
+      pop[i].data = {{static_cast<int>(i % 3), 1, 2, 3}};
+    }
+
+    ga.Run(pop, rng);
+
+    bool fitness_ok = true;
+    for (const auto& it : pop) {
+      fitness_ok = fitness_ok && (it.is_dirty() || it.fitness == Sum(it.data));
+    }
+
+    std::cout << "Ga: " << ga.evaluation.hits() << " hits, "
+              << ga.evaluation.misses() << " misses" << std::endl;
+    Check(fitness_ok, "population fitness");
+    Check(ga.evaluation.hits() > 0 &&
+              static_cast<uint64_t>(count) == ga.evaluation.misses(),
+          "parallel misses");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <array>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metasinf/checkpoint.h"
+#include "metasinf/nsga2.h"
+#include "metasinf/population.h"
+#include "metasinf/population_matrix.h"
+#include "metasinf/random.h"
+
+using Rng = std::mt19937;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+int main() {
+  enum : uint32_t { kVersion = 3 };
+
+  Rng rng(42);
+  snf::Philox4x32 philox(7, 1);
+  philox.discard(5);
+
+  snf::Population<std::vector<int>, double> pop(4);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i].data.assign(i + 1, static_cast<int>(i));
+    pop[i].fitness = 0.5 * i;
+  }
+
+  snf::Population<std::array<double, 3>, double> arrays(2);
+  arrays[1].data[2] = 1.5;
+  arrays[1].fitness = 2.0;
+
+  snf::PopulationMatrix<float, double> matrix(2, 3);
+  matrix.row(1)[2] = 4.0f;
+  matrix.set_fitness(1, 3.0);
+
+  std::vector<bool> bits = {true, false, true, true};
+  std::string name = "checkpoint";
+
+  std::string buffer;
+  snf::CheckpointWriter writer(buffer);
+  Check(snf::SaveCheckpoint(writer, kVersion, rng, philox, pop, arrays, matrix,
+                            bits, name),
+        "save");
+
+  // Round trip.
+  Rng rng2;
+  snf::Philox4x32 philox2;
+  snf::Population<std::vector<int>, double> pop2;
+  snf::Population<std::array<double, 3>, double> arrays2;
+  snf::PopulationMatrix<float, double> matrix2;
+  std::vector<bool> bits2;
+  std::string name2;
+  {
+    std::istringstream in(buffer);
+    Check(snf::LoadCheckpoint(in, kVersion, rng2, philox2, pop2, arrays2,
+                              matrix2, bits2, name2),
+          "load");
+  }
+
+  Check(rng() == rng2(), "mt19937");
+  Check(philox() == philox2(), "philox");
+  Check(pop2.size() == pop.size(), "population size");
+  for (size_t i = 0; i < pop.size() && i < pop2.size(); ++i) {
+    Check(pop2[i].data == pop[i].data && pop2[i].fitness == pop[i].fitness,
+          "population individual");
+  }
+
+  Check(arrays2.size() == 2 && arrays2[1].data[2] == 1.5 &&
+            arrays2[1].fitness == 2.0,
+        "array population");
+  Check(matrix2.size() == 2 && matrix2.row(1)[2] == 4.0f &&
+            matrix2.fitness()[1] == 3.0 && matrix2[0].is_dirty(),
+        "population matrix");
+  Check(bits2 == bits, "bit vector");
+  Check(name2 == name, "string");
+
+  // A wrong layout version is rejected.
+  {
+    std::istringstream in(buffer);
+    Check(!snf::LoadCheckpoint(in, kVersion + 1, rng2, philox2, pop2,
+                               arrays2, matrix2, bits2, name2),
+          "version mismatch");
+  }
+
+  // A truncated checkpoint is rejected.
+  {
+    std::istringstream in(buffer.substr(0, buffer.size() - 5));
+    Check(!snf::LoadCheckpoint(in, kVersion, rng2, philox2, pop2, arrays2,
+                               matrix2, bits2, name2),
+          "truncated");
+  }
+
+  // A corrupted size field is rejected before anything is allocated.
+  {
+    std::string corrupt;
+    snf::CheckpointWriter corrupt_writer(corrupt);
+    snf::SaveCheckpoint(corrupt_writer, kVersion, std::vector<int>(3, 1));
+    // The size of the vector follows the 20-byte header.
+    uint64_t size = uint64_t(1) << 60;
+    corrupt.replace(20, sizeof(size), reinterpret_cast<const char*>(&size),
+                    sizeof(size));
+
+    std::vector<int> values;
+    std::istringstream in(corrupt);
+    Check(!snf::LoadCheckpoint(in, kVersion, values) && values.empty(),
+          "corrupted size");
+  }
+
+  // Multi-objective individuals keep their objectives, rank and crowding.
+  {
+    snf::MultiPopulation<std::vector<int>> multi_pop(3);
+    for (size_t i = 0; i < multi_pop.size(); ++i) {
+      multi_pop[i].data.assign(i + 1, static_cast<int>(i));
+      multi_pop[i].objectives = {0.5 * i, 1.0 - 0.5 * i};
+      multi_pop[i].rank = i;
+      multi_pop[i].crowding = 0.25 * i;
+    }
+
+    multi_pop[2].mark_dirty();
+
+    std::string multi;
+    snf::CheckpointWriter w(multi);
+    Check(snf::SaveCheckpoint(w, 1, multi_pop), "multi save");
+
+    snf::MultiPopulation<std::vector<int>> multi_pop2;
+    std::istringstream in(multi);
+    bool loaded = snf::LoadCheckpoint(in, 1, multi_pop2) &&
+                  multi_pop2.size() == multi_pop.size();
+    for (size_t i = 0; loaded && i < multi_pop.size(); ++i) {
+      loaded = multi_pop2[i].data == multi_pop[i].data &&
+               multi_pop2[i].objectives == multi_pop[i].objectives &&
+               multi_pop2[i].rank == multi_pop[i].rank &&
+               multi_pop2[i].crowding == multi_pop[i].crowding;
+    }
+
+    Check(loaded && multi_pop2[2].is_dirty(), "multi round trip");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
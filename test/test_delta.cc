@@ -0,0 +1,198 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+
+#include "metasinf/crossover.h"
+#include "metasinf/delta.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+static constexpr int kSize = 16;
+static constexpr int kPairs = kSize * (kSize - 1) / 2;
+using State = std::array<uint8_t, kSize>;
+using Rng = std::mt19937;
+using Log = snf::MutationLog<uint8_t>;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+bool Attacks(int x0, int y0, int x1, int y1) {
+  return std::abs(x0 - x1) == std::abs(y0 - y1);
+}
+
+// Count the pairs of queens that do not attack each other.
+double f(const State& value) {
+  int conflicts = 0;
+  for (int i = 0; i < kSize; ++i) {
+    for (int j = i + 1; j < kSize; ++j) {
+      if (Attacks(i, value[i], j, value[j])) {
+        ++conflicts;
+      }
+    }
+  }
+
+  return kPairs - conflicts;
+}
+
+// Count the conflicts that involve the changed queens, given their rows.
+int CountConflicts(const State& value, const Log& log, const State& rows,
+                   const std::array<bool, kSize>& changed) {
+  int conflicts = 0;
+  for (size_t i = 0; i < log.size(); ++i) {
+    int x = static_cast<int>(log[i].first);
+    for (int j = 0; j < kSize; ++j) {
+      if (!changed[j] && Attacks(x, rows[x], j, value[j])) {
+        ++conflicts;
+      }
+    }
+
+    for (size_t k = i + 1; k < log.size(); ++k) {
+      int z = static_cast<int>(log[k].first);
+      if (Attacks(x, rows[x], z, rows[z])) {
+        ++conflicts;
+      }
+    }
+  }
+
+  return conflicts;
+}
+
+// Count the full and the delta evaluations.
+struct Evaluation {
+  long* full;
+  long* delta;
+
+  double operator()(State& value, Rng& rng) {
+    ++*full;
+    return f(value);
+  }
+
+  // Only the conflicts of the queens moved by the mutation are recounted.
+  double Delta(const State& value, double fitness, const Log& log, Rng& rng) {
+    ++*delta;
+    std::array<bool, kSize> changed{};
+    State old_rows = value;
+    for (const auto& it : log) {
+      changed[it.first] = true;
+      old_rows[it.first] = it.second;
+    }
+
+    int old_conflicts = CountConflicts(value, log, old_rows, changed);
+    int new_conflicts = CountConflicts(value, log, value, changed);
+    return fitness + old_conflicts - new_conflicts;
+  }
+};
+
+static_assert(snf::HasMutationLog<snf::MutationSwap, State, Rng>::value,
+              "MutationSwap records its changes");
+static_assert(
+    !snf::HasMutationLog<snf::MutationNormal<double>, double, Rng>::value,
+    "MutationNormal does not record its changes");
+static_assert(snf::IsDeltaEvaluator<Evaluation, State, double, Rng>::value,
+              "Evaluation supports delta evaluation");
+
+State RandomState(Rng& rng) {
+  State state;
+  for (int i = 0; i < kSize; ++i) {
+    state[i] = i;
+  }
+
+  std::shuffle(state.begin(), state.end(), rng);
+  return state;
+}
+
+// Check that the log lists every changed position once with its old value,
+// and that the delta evaluation matches a full evaluation.
+template <typename MutationFunc>
+void CheckMutation(MutationFunc mutation, const char* name, Rng& rng) {
+  long full = 0;
+  long delta = 0;
+  Evaluation evaluation{&full, &delta};
+  Log log;
+  bool log_ok = true;
+  bool delta_ok = true;
+  for (int run = 0; run < 1000; ++run) {
+    State value = RandomState(rng);
+    State before = value;
+    double fitness = f(value);
+
+    log.clear();
+    mutation(value, log, rng);
+
+    State restored = value;
+    std::array<bool, kSize> seen{};
+    for (const auto& it : log) {
+      log_ok = log_ok && !seen[it.first];
+      seen[it.first] = true;
+      restored[it.first] = it.second;
+    }
+
+    for (int i = 0; i < kSize; ++i) {
+      log_ok = log_ok && (seen[i] || value[i] == before[i]);
+    }
+
+    log_ok = log_ok && restored == before;
+    double updated = evaluation.Delta(value, fitness, log, rng);
+    delta_ok = delta_ok && updated == f(value);
+  }
+
+  std::cout << name << ": " << (log_ok && delta_ok ? "ok" : "mismatch")
+            << std::endl;
+  Check(log_ok, name);
+  Check(delta_ok, name);
+}
+
+int main() {
+  Rng rng(1);
+
+  CheckMutation(snf::MutationSwap(1), "swap", rng);
+  CheckMutation(snf::MutationSwap(3), "swap x3", rng);
+  CheckMutation(snf::MutationInvert(), "invert", rng);
+  CheckMutation(snf::MutationMove(), "move", rng);
+
+  // The fitness that Ga keeps up to date through delta evaluation must
+  // match a full evaluation.
+  long full = 0;
+  long delta = 0;
+  auto ga = snf::make_ga(
+      0.5, 0.5, Evaluation{&full, &delta},
+      snf::SelectionSus(snf::SelectionSize(0.4)),
+      snf::CrossoverPmx(),
+      snf::MutationSwap(1),
+      snf::ReplacementElitist(snf::SelectionSize(0.6)),
+      snf::TerminationGeneration(200));
+
+  snf::Population<State, double> pop(20);
+  for (auto& it : pop) {
+    it.data = RandomState(rng);
+  }
+
+  ga.Run(pop, rng);
+
+  bool fitness_ok = true;
+  for (const auto& it : pop) {
+    fitness_ok = fitness_ok && (it.is_dirty() || it.fitness == f(it.data));
+  }
+
+  std::cout << "Ga: " << full << " full, " << delta << " delta evaluations"
+            << std::endl;
+  Check(delta > 0, "delta evaluations used");
+  Check(fitness_ok, "population fitness");
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/rate.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+static constexpr int kSize = 32;
+static constexpr int kPairs = kSize * (kSize - 1) / 2;
+// The benchmark prints the median number of evaluations over kRuns seeds.
+// When the rate controllers were added it printed 19854 (fixed), 4838 (1/5th
+// success rule) and 4557 (adaptive pursuit); since elitism breaks fitness
+// ties toward the offspring it prints 4950, 4989 and 2616.
+static constexpr int kRuns = 15;
+static constexpr int kGenerations = 100000;
+
+// Upper bound on the median number of evaluations. Elitism that keeps the
+// parents over equally fit offspring stalls on the fitness plateaus and
+// takes over 200000.
+static constexpr long kMaxMedian = 50000;
+using State = std::array<uint8_t, kSize>;
+using Rng = std::mt19937;
+
+// Count the pairs of queens that do not attack each other, and the number
+// of evaluations.
+struct Evaluation {
+  long* count;
+
+  double operator()(State& value, Rng& rng) {
+    ++*count;
+    int conflicts = 0;
+    for (int i = 0; i < kSize; ++i) {
+      for (int j = i + 1; j < kSize; ++j) {
+        if (std::abs(i - j) == std::abs(value[i] - value[j])) {
+          ++conflicts;
+        }
+      }
+    }
+
+    return kPairs - conflicts;
+  }
+};
+
+using Termination =
+    snf::TerminationOr<snf::TerminationFitness<double>,
+                       snf::TerminationGeneration>;
+
+// Return the number of evaluations needed to solve the problem, or -1 if it
+// was not solved.
+template <typename RateFunc>
+long Solve(const RateFunc& rate, unsigned int seed) {
+  Rng rng(seed);
+  long count = 0;
+
+  snf::Ga<Evaluation, snf::SelectionSus, snf::CrossoverPmx, snf::MutationSwap,
+          snf::ReplacementElitist, Termination, RateFunc>
+      ga(0.2, 0.8, Evaluation{&count},
+         snf::SelectionSus(snf::SelectionSize(0.4)), snf::CrossoverPmx(),
+         snf::MutationSwap(1),
+         snf::ReplacementElitist(snf::SelectionSize(0.6)),
+         Termination(snf::TerminationFitness<double>(kPairs),
+                     snf::TerminationGeneration(kGenerations)),
+         rate);
+
+  snf::Population<State, double> pop(20);
+  for (auto& it : pop) {
+    for (int i = 0; i < kSize; ++i) {
+      it.data[i] = i;
+    }
+
+    std::shuffle(it.data.begin(), it.data.end(), rng);
+  }
+
+  ga.Run(pop, rng);
+  for (const auto& it : pop) {
+    if (it.fitness >= kPairs) {
+      return count;
+    }
+  }
+
+  return -1;
+}
+
+// Print the median number of evaluations over the runs. Return whether
+// every run was solved within the expected budget.
+template <typename RateFunc>
+bool Benchmark(const char* name, const RateFunc& rate) {
+  std::vector<long> counts;
+  int unsolved = 0;
+  for (int i = 0; i < kRuns; ++i) {
+    long count = Solve(rate, i + 1);
+    if (count < 0) {
+      ++unsolved;
+    }
+
+    counts.push_back(count < 0 ? std::numeric_limits<long>::max() : count);
+  }
+
+  std::sort(counts.begin(), counts.end());
+  long median = counts[counts.size() / 2];
+  std::cout << name << ": " << median << " evaluations";
+  if (unsolved > 0) {
+    std::cout << " (" << unsolved << " runs unsolved)";
+  }
+
+  std::cout << std::endl;
+  return unsolved == 0 && median <= kMaxMedian;
+}
+
+int main() {
+  bool ok = true;
+  ok = Benchmark("Fixed", snf::RateFixed()) && ok;
+  ok = Benchmark("1/5th success rule", snf::RateOneFifth()) && ok;
+  ok = Benchmark("Adaptive pursuit",
+                 snf::RatePursuit({{0.05, 0.8}, {0.2, 0.8}, {0.5, 0.8},
+                                   {1.0, 0.8}, {0.2, 0.3}, {1.0, 0.3}})) &&
+       ok;
+  return ok ? 0 : 1;
+}
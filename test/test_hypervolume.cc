@@ -0,0 +1,275 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/hypervolume.h"
+#include "metasinf/mutation.h"
+#include "metasinf/nsga2.h"
+#include "metasinf/termination.h"
+
+static constexpr int kSize = 30;
+using State = std::array<double, kSize>;
+using Rng = std::mt19937;
+using Pop = snf::MultiPopulation<int>;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+bool Near(double lhs, double rhs) {
+  return std::abs(lhs - rhs) <= 1e-9 * std::max(1.0, std::abs(rhs));
+}
+
+// Return the hypervolume of the points by inclusion-exclusion over the
+// intersections of their boxes.
+double InclusionExclusion(const std::vector<double>& points,
+                          const std::vector<double>& reference) {
+  size_t n = reference.size();
+  size_t count = points.size() / n;
+  double volume = 0.0;
+  for (size_t mask = 1; mask < (size_t(1) << count); ++mask) {
+    double box = 1.0;
+    int sign = -1;
+    for (size_t j = 0; j < n; ++j) {
+      double corner = HUGE_VAL;
+      for (size_t i = 0; i < count; ++i) {
+        if (mask & (size_t(1) << i)) {
+          corner = std::min(corner, points[i * n + j]);
+        }
+      }
+
+      box *= std::max(corner - reference[j], 0.0);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      if (mask & (size_t(1) << i)) {
+        sign = -sign;
+      }
+    }
+
+    volume += sign * box;
+  }
+
+  return volume;
+}
+
+// Return `count` mutually non-dominated points with `n` objectives, on the
+// positive part of the unit sphere.
+std::vector<double> Front(size_t count, size_t n, Rng& rng) {
+  std::normal_distribution<double> dist;
+  std::vector<double> points(count * n);
+  for (size_t i = 0; i < count; ++i) {
+    double norm = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+      points[i * n + j] = std::abs(dist(rng));
+      norm += points[i * n + j] * points[i * n + j];
+    }
+
+    for (size_t j = 0; j < n; ++j) {
+      points[i * n + j] /= std::sqrt(norm);
+    }
+  }
+
+  return points;
+}
+
+// Return the indices of the points that survive the greedy removal of the
+// least contributor, with every contribution recomputed after each removal.
+std::vector<int> Greedy(std::vector<double> points, size_t count,
+                        const std::vector<double>& reference) {
+  snf::Hypervolume<double> hypervolume;
+  size_t n = reference.size();
+  std::vector<int> alive(points.size() / n);
+  for (size_t i = 0; i < alive.size(); ++i) {
+    alive[i] = static_cast<int>(i);
+  }
+
+  while (alive.size() > count) {
+    size_t worst = 0;
+    double least = HUGE_VAL;
+    for (size_t i = 0; i < alive.size(); ++i) {
+      double contribution = hypervolume.Contribution(points, i, reference);
+      if (contribution < least) {
+        least = contribution;
+        worst = i;
+      }
+    }
+
+    points.erase(points.begin() + worst * n, points.begin() + (worst + 1) * n);
+    alive.erase(alive.begin() + worst);
+  }
+
+  std::sort(alive.begin(), alive.end());
+  return alive;
+}
+
+// Return the indices of the points that survive `ReplacementHypervolume`.
+std::vector<int> Replace(const std::vector<double>& points, size_t count,
+                         const std::vector<double>& reference,
+                         size_t samples, Rng& rng) {
+  size_t n = reference.size();
+  Pop src, dst;
+  for (size_t i = 0; i < points.size() / n; ++i) {
+    auto& pop = i < count ? dst : src;
+    pop.emplace_back(static_cast<int>(i));
+    pop.back().objectives.assign(points.begin() + i * n,
+                                 points.begin() + (i + 1) * n);
+  }
+
+  snf::ReplacementHypervolume(reference, samples)(src, dst, rng);
+  std::vector<int> alive;
+  for (const auto& it : dst) {
+    alive.push_back(it.data);
+  }
+
+  std::sort(alive.begin(), alive.end());
+  return alive;
+}
+
+// Minimize ZDT1, f1 = x1 and f2 = g (1 - sqrt(x1 / g)), whose Pareto front
+// is f2 = 1 - sqrt(f1). The objectives are negated to be maximized.
+void Zdt1(State& value, std::vector<double>& objectives, Rng& rng) {
+  for (auto& it : value) {
+    it = std::min(std::max(it, 0.0), 1.0);
+  }
+
+  double sum = 0.0;
+  for (int i = 1; i < kSize; ++i) {
+    sum += value[i];
+  }
+
+  double g = 1.0 + 9.0 * sum / (kSize - 1);
+  objectives.push_back(-value[0]);
+  objectives.push_back(-g * (1.0 - std::sqrt(value[0] / g)));
+}
+
+int main() {
+  Rng rng(1);
+  snf::Hypervolume<double> hypervolume;
+
+  // Volume and contributions match inclusion-exclusion, including points
+  // that do not dominate the reference point and dominated points.
+  for (size_t n = 1; n <= 5; ++n) {
+    std::uniform_real_distribution<double> dist;
+    std::vector<double> points(10 * n);
+    for (auto& it : points) {
+      it = dist(rng);
+    }
+
+    std::vector<double> reference(n, 0.1);
+    double volume = InclusionExclusion(points, reference);
+    Check(Near(hypervolume.Volume(points, reference), volume), "volume");
+
+    bool contributions_ok = true;
+    for (size_t i = 0; i < 10; ++i) {
+      std::vector<double> others(points);
+      others.erase(others.begin() + i * n, others.begin() + (i + 1) * n);
+      double contribution = volume - InclusionExclusion(others, reference);
+      contributions_ok =
+          contributions_ok &&
+          Near(hypervolume.Contribution(points, i, reference), contribution);
+    }
+
+    Check(contributions_ok, "contribution");
+  }
+
+  // The incremental reduction removes the same points as the greedy one.
+  for (size_t n = 2; n <= 5; ++n) {
+    std::vector<double> points = Front(12, n, rng);
+    std::vector<double> reference(n, 0.0);
+    Check(Replace(points, 6, reference, 0, rng) == Greedy(points, 6, reference),
+          "exact reduction");
+  }
+
+  // The sampled reduction agrees with the greedy one when the samples are
+  // dense enough to separate the contributions. The last point nearly
+  // duplicates the largest contributor, so removing one of the two must
+  // raise the contribution of the other.
+  {
+    std::vector<double> points = Front(10, 6, rng);
+    std::vector<double> reference(6, 0.0);
+    size_t largest = 0;
+    for (size_t i = 1; i < 10; ++i) {
+      if (hypervolume.Contribution(points, i, reference) >
+          hypervolume.Contribution(points, largest, reference)) {
+        largest = i;
+      }
+    }
+
+    std::vector<double> twin(points.begin() + largest * 6,
+                             points.begin() + (largest + 1) * 6);
+    twin[0] *= 1.001;
+    double norm = 0.0;
+    for (double it : twin) {
+      norm += it * it;
+    }
+
+    for (double it : twin) {
+      points.push_back(it / std::sqrt(norm));
+    }
+
+    std::vector<int> greedy = Greedy(points, 9, reference);
+    size_t twins = std::count(greedy.begin(), greedy.end(), largest) +
+                   std::count(greedy.begin(), greedy.end(), 10);
+    Check(Replace(points, 9, reference, 200000, rng) == greedy && twins == 1,
+          "sampled reduction");
+  }
+
+  // SMS-EMOA on ZDT1.
+  {
+    auto sms_emoa = snf::make_nsga2(
+        1.0, 0.9, Zdt1,
+        snf::CrossoverVector<snf::CrossoverSbx<double>>(
+            0.5, snf::CrossoverSbx<double>(15.0)),
+        snf::MutationVector<snf::MutationNormal<double>>(
+            1.0 / kSize, snf::MutationNormal<double>(0.1, 0.0, 1.0)),
+        snf::TerminationGeneration(250),
+        snf::ReplacementHypervolume({-1.1, -11.0}));
+
+    snf::MultiPopulation<State> pop(40);
+    for (auto& it : pop) {
+      std::uniform_real_distribution<double> dist;
+      for (auto& x : it.data) {
+        x = dist(rng);
+      }
+    }
+
+    sms_emoa.Run(pop, rng);
+
+    size_t count = 0;
+    double distance = 0.0;
+    double spread = 0.0;
+    bool crowding_ok = true;
+    for (const auto& it : pop) {
+      crowding_ok = crowding_ok && it.crowding >= 0.0;
+      if (it.rank == 0) {
+        double f1 = -it.objectives[0];
+        spread = std::max(spread, f1);
+        double f2 = -it.objectives[1];
+        distance += f2 - (1.0 - std::sqrt(f1));
+        ++count;
+      }
+    }
+
+    std::cout << "SMS-EMOA: " << count << " individuals, mean distance "
+              << distance / count << std::endl;
+    Check(pop.size() == 40 && count > 0 && crowding_ok, "SMS-EMOA front");
+    Check(spread > 0.5, "SMS-EMOA spread");
+    Check(distance / count < 0.01, "SMS-EMOA distance");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
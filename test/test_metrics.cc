@@ -0,0 +1,243 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/metrics.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+using Rng = std::mt19937;
+using Pop = snf::Population<double, double>;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+bool Near(double lhs, double rhs, double tolerance) {
+  return std::abs(lhs - rhs) <= tolerance * std::max(1.0, std::abs(rhs));
+}
+
+static uint64_t evaluations = 0;
+static uint64_t crossovers = 0;
+static uint64_t mutations = 0;
+
+// Fitness values far from zero compared to their spread.
+double Evaluate(double& value, Rng& rng) {
+  ++evaluations;
+  return 1e9 + std::sin(value);
+}
+
+struct Crossover {
+  template <typename Rng>
+  void operator()(double& value0, double& value1, Rng& rng) {
+    ++crossovers;
+    snf::CrossoverReal<double>()(value0, value1, rng);
+  }
+};
+
+struct Mutation {
+  template <typename Rng>
+  void operator()(double& value, Rng& rng) {
+    ++mutations;
+    snf::MutationNormal<double>(0.5, -10.0, 10.0)(value, rng);
+  }
+};
+
+// Metrics observer that also records the statistics of the evaluated
+// individuals it is shown, for every generation.
+template <typename SinkFunc>
+struct Recorder : snf::Metrics<SinkFunc> {
+  explicit Recorder(const SinkFunc& sink) : snf::Metrics<SinkFunc>(sink) {}
+
+  std::vector<snf::PopulationStats<double>> stats;
+  std::vector<double> fitness;
+
+  template <typename Pop>
+  void Observe(const Pop& pop) {
+    snf::Metrics<SinkFunc>::Observe(pop);
+    for (const auto& it : pop) {
+      if (!it.is_dirty()) {
+        fitness.push_back(it.fitness);
+      }
+    }
+  }
+
+  void EndGeneration() {
+    snf::Metrics<SinkFunc>::EndGeneration();
+    stats.push_back(snf::ComputeStats(fitness.data(), fitness.size()));
+    fitness.clear();
+  }
+};
+
+template <typename SinkFunc>
+Recorder<SinkFunc> RunGa(const SinkFunc& sink, int generations) {
+  auto ga = snf::make_ga(
+      0.3, 0.8, Evaluate, snf::SelectionTournament(snf::SelectionSize(0.5), 2),
+      Crossover(), Mutation(), snf::ReplacementElitist(snf::SelectionSize(0.5)),
+      snf::TerminationGeneration(generations), snf::RateFixed(),
+      Recorder<SinkFunc>(sink));
+
+  Rng rng(7);
+  Pop pop(24);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+    it.data = dist(rng);
+  }
+
+  evaluations = 0;
+  crossovers = 0;
+  mutations = 0;
+  ga.Run(pop, rng);
+  return ga.observer;
+}
+
+std::vector<std::string> Split(const std::string& text, char separator) {
+  std::vector<std::string> fields;
+  std::istringstream in(text);
+  std::string field;
+  while (std::getline(in, field, separator)) {
+    fields.push_back(field);
+  }
+
+  return fields;
+}
+
+int main() {
+  // The fitness statistics skip dirty individuals, span every observed
+  // population, and stay accurate for large fitness values.
+  {
+    Pop pop0(5), pop1(4);
+    std::vector<double> fitness;
+    for (size_t i = 0; i < pop0.size(); ++i) {
+      pop0[i].fitness = 1e9 + 1e-3 * i;
+      fitness.push_back(pop0[i].fitness);
+    }
+
+    for (size_t i = 0; i < pop1.size(); ++i) {
+      if (i != 2) {
+        pop1[i].fitness = 1e9 - 2e-3 * i;
+        fitness.push_back(pop1[i].fitness);
+      }
+    }
+
+    snf::Metrics<> metrics;
+    metrics.Observe(pop0);
+    metrics.Observe(pop1);
+    metrics.EndGeneration();
+
+    auto stats = snf::ComputeStats(fitness.data(), fitness.size());
+    const snf::GenerationMetrics& last = metrics.last();
+    Check(last.fitness_count == 8, "fitness count");
+    Check(last.best_fitness == stats.max, "best fitness");
+    Check(Near(last.mean_fitness, stats.mean, 1e-15), "mean fitness");
+    Check(Near(last.std_fitness, stats.std_dev(), 1e-6) &&
+              last.std_fitness > 1e-3,
+          "std fitness");
+
+    metrics.EndGeneration();
+    Check(metrics.last().generation == 1 && metrics.last().fitness_count == 0,
+          "fitness reset");
+  }
+
+  // CSV rows of a short run: one per generation after the header, with the
+  // counters of the operators and the statistics of the population.
+  const int kGenerations = 6;
+  std::vector<uint64_t> row_evaluations;
+  {
+    std::ostringstream out;
+    auto metrics = RunGa(snf::MetricsSinkCsv(out), kGenerations);
+    std::vector<std::string> lines = Split(out.str(), '\n');
+    Check(lines.size() == kGenerations + 1, "csv rows");
+    Check(lines[0] ==
+              "generation,seconds,evaluate_seconds,select_seconds,"
+              "vary_seconds,replace_seconds,terminate_seconds,"
+              "sample_seconds,update_seconds,evolve_seconds,"
+              "migrate_seconds,evaluations,crossovers,mutations,throughput,"
+              "fitness_count,best_fitness,mean_fitness,std_fitness",
+          "csv header");
+
+    size_t columns = Split(lines[0], ',').size();
+    int counter = 2 + snf::GenerationMetrics::kPhaseCount;
+    int fitness = counter + snf::GenerationMetrics::kCounterCount + 1;
+    uint64_t sums[3] = {0, 0, 0};
+    bool rows_ok = true;
+    bool fitness_ok = true;
+    for (int i = 1; i < static_cast<int>(lines.size()); ++i) {
+      std::vector<std::string> fields = Split(lines[i], ',');
+      if (fields.size() != columns || std::stoi(fields[0]) != i - 1) {
+        rows_ok = false;
+        continue;
+      }
+
+      for (int j = 0; j < 3; ++j) {
+        sums[j] += std::stoull(fields[counter + j]);
+      }
+
+      row_evaluations.push_back(std::stoull(fields[counter]));
+      const snf::PopulationStats<double>& stats = metrics.stats[i - 1];
+      fitness_ok = fitness_ok &&
+                   std::stoull(fields[fitness]) == stats.count &&
+                   Near(std::stod(fields[fitness + 1]), stats.max, 1e-5) &&
+                   Near(std::stod(fields[fitness + 2]), stats.mean, 1e-5) &&
+                   Near(std::stod(fields[fitness + 3]), stats.std_dev(), 1e-5);
+    }
+
+    Check(rows_ok, "csv columns");
+    Check(fitness_ok, "csv fitness");
+    Check(row_evaluations.size() == kGenerations && row_evaluations[0] == 24,
+          "csv first generation");
+    Check(sums[0] == evaluations && sums[1] == crossovers &&
+              sums[2] == mutations,
+          "csv counters");
+
+    const snf::GenerationMetrics& totals = metrics.totals();
+    Check(totals.generation == kGenerations - 1 &&
+              totals.counter(snf::MetricsCounter::kEvaluations) ==
+                  evaluations &&
+              totals.counter(snf::MetricsCounter::kCrossovers) == crossovers &&
+              totals.counter(snf::MetricsCounter::kMutations) == mutations,
+          "totals");
+    Check(crossovers > 0 && mutations > 0, "operators counted");
+  }
+
+  // JSON objects of the same run, one per line.
+  {
+    std::ostringstream out;
+    RunGa(snf::MetricsSinkJson(out), kGenerations);
+    std::vector<std::string> lines = Split(out.str(), '\n');
+    bool lines_ok = lines.size() == kGenerations &&
+                    row_evaluations.size() == kGenerations;
+    for (size_t i = 0; lines_ok && i < lines.size(); ++i) {
+      std::string prefix = "{\"generation\":" + std::to_string(i) + ",";
+      std::string evaluations_field =
+          "\"evaluations\":" + std::to_string(row_evaluations[i]) + ",";
+      lines_ok = lines[i].compare(0, prefix.size(), prefix) == 0 &&
+                 lines[i].find(",\"phases\":{\"evaluate\":") !=
+                     std::string::npos &&
+                 lines[i].find(evaluations_field) != std::string::npos &&
+                 lines[i].find(",\"fitness\":{\"count\":") !=
+                     std::string::npos &&
+                 lines[i].compare(lines[i].size() - 2, 2, "}}") == 0;
+    }
+
+    Check(lines_ok, "json lines");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
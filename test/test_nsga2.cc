@@ -0,0 +1,74 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/mutation.h"
+#include "metasinf/nsga2.h"
+#include "metasinf/termination.h"
+
+static constexpr int kSize = 30;
+using State = std::array<double, kSize>;
+using Rng = std::mt19937;
+
+// Minimize ZDT1, f1 = x1 and f2 = g (1 - sqrt(x1 / g)), whose Pareto front
+// is f2 = 1 - sqrt(f1). The objectives are negated to be maximized.
+void Zdt1(State& value, std::vector<double>& objectives, Rng& rng) {
+  for (auto& it : value) {
+    it = std::min(std::max(it, 0.0), 1.0);
+  }
+
+  double sum = 0.0;
+  for (int i = 1; i < kSize; ++i) {
+    sum += value[i];
+  }
+
+  double g = 1.0 + 9.0 * sum / (kSize - 1);
+  objectives.push_back(-value[0]);
+  objectives.push_back(-g * (1.0 - std::sqrt(value[0] / g)));
+}
+
+int main() {
+  Rng rng;
+  rng.seed(static_cast<unsigned int>(time(nullptr)));
+
+  auto nsga2 = snf::make_nsga2(
+      1.0, 0.9, Zdt1,
+      snf::CrossoverVector<snf::CrossoverSbx<double>>(
+          0.5, snf::CrossoverSbx<double>(15.0)),
+      snf::MutationVector<snf::MutationNormal<double>>(
+          1.0 / kSize, snf::MutationNormal<double>(0.1, 0.0, 1.0)),
+      snf::TerminationGeneration(250));
+
+  snf::MultiPopulation<State> pop(100);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    for (auto& x : it.data) {
+      x = dist(rng);
+    }
+  }
+
+  nsga2.Run(pop, rng);
+
+  // Report the size of the first front and its mean distance to the Pareto
+  // front.
+  size_t count = 0;
+  double distance = 0.0;
+  for (const auto& it : pop) {
+    if (it.rank == 0) {
+      double f1 = -it.objectives[0];
+      double f2 = -it.objectives[1];
+      distance += f2 - (1.0 - std::sqrt(f1));
+      ++count;
+    }
+  }
+
+  std::cout << "Front: " << count << " individuals, mean distance "
+            << distance / count << std::endl;
+  return 0;
+}
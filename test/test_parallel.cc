@@ -0,0 +1,160 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <iostream>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/island_model.h"
+#include "metasinf/migration.h"
+#include "metasinf/mutation.h"
+#include "metasinf/parallel.h"
+#include "metasinf/random.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+using Rng = snf::Philox4x32;
+
+// Maximize y = sin^6(8x) 0<x<1
+double f(double& value, Rng& rng) {
+  return std::pow(std::sin(8.0 * value), 6);
+}
+
+// Noisy variant of `f`.
+double g(double& value, Rng& rng) {
+  std::uniform_real_distribution<double> dist(0.0, 0.1);
+  return f(value, rng) + dist(rng);
+}
+
+// Evaluate noisy genomes on `thread_count` workers. Returns the fitness
+// values followed by the next number of the generator.
+std::vector<double> EvaluateNoisy(size_t thread_count) {
+  Rng rng(7);
+  snf::ThreadPool pool(thread_count);
+  auto evaluation = snf::make_evaluation_parallel(pool, g, 3);
+
+  std::vector<double> data(50);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = 0.02 * i;
+  }
+
+  std::vector<double> fitness(data.size());
+  evaluation(snf::Span<double>(data.data(), data.size()),
+             snf::Span<double>(fitness.data(), fitness.size()), rng);
+  fitness.push_back(rng());
+  return fitness;
+}
+
+// Run a noisy Ga for a few generations from a fixed seed, with the
+// variation stage on `executor` if given, or serially with the specified
+// tile size. Returns the genomes and fitness values of the final population
+// followed by the next number of the generator.
+template <typename Executor>
+std::vector<double> RunGa(Executor* executor, size_t tile_size) {
+  Rng rng(11);
+  auto ga = snf::make_ga(
+      0.2, 0.8, g, snf::SelectionTournament(snf::SelectionSize(0.8), 3),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementElitist(snf::SelectionSize(0.2)),
+      snf::TerminationGeneration(20));
+  ga.tile_size = tile_size;
+
+  snf::Population<double, double> pop(101);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    it.data = dist(rng);
+  }
+
+  if (executor != nullptr) {
+    ga.Run(pop, rng, *executor);
+  } else {
+    ga.Run(pop, rng);
+  }
+
+  std::vector<double> result;
+  for (const auto& it : pop) {
+    result.push_back(it.data);
+    result.push_back(it.fitness);
+  }
+
+  result.push_back(rng());
+  return result;
+}
+
+int main() {
+  // The evaluation does not depend on the number of workers.
+  if (EvaluateNoisy(1) != EvaluateNoisy(4)) {
+    std::cout << "Parallel evaluation depends on the number of workers"
+              << std::endl;
+    return 1;
+  }
+
+  // The parallel variation stage does not depend on the number of workers.
+  {
+    snf::SerialExecutor serial;
+    snf::ThreadPool pool(4);
+    if (RunGa(&serial, 0) != RunGa(&pool, 0)) {
+      std::cout << "Parallel variation depends on the number of workers"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // The fused pipeline does not depend on the tile size.
+  {
+    std::vector<double> result = RunGa<snf::SerialExecutor>(nullptr, 2);
+    for (size_t tile_size : {6, 7, 32, 1000}) {
+      if (RunGa<snf::SerialExecutor>(nullptr, tile_size) != result) {
+        std::cout << "Fused pipeline depends on the tile size" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  Rng rng;
+  rng.seed(static_cast<unsigned int>(time(nullptr)));
+
+  snf::ThreadPool pool;
+  snf::MigrationRing migration(snf::SelectionSize(0.1));
+  snf::IslandModel<snf::MigrationRing> island_model(50, migration);
+
+  auto ga = snf::make_ga(
+      0.2, 0.8, snf::make_evaluation_parallel(pool, f),
+      snf::SelectionSus(snf::SelectionSize(0.4)),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementElitist(snf::SelectionSize(0.6)),
+      snf::TerminationGeneration(1000));
+
+  using Island = snf::Island<double, double, decltype(ga)>;
+
+  std::vector<Island> islands;
+  for (int i = 0; i < 6; ++i) {
+    Island island(ga);
+    island.pop.resize(20);
+    for (auto& it : island.pop) {
+      std::uniform_real_distribution<double> dist;
+      it.data = dist(rng);
+    }
+
+    islands.push_back(island);
+  }
+
+  island_model.Run(islands, rng, pool);
+
+  int i = 0;
+  for (auto& island : islands) {
+    if (!island.pop.empty()) {
+      snf::Evaluate(island.pop, island.ga.evaluation, rng);
+      std::sort(island.pop.begin(), island.pop.end());
+
+      auto best = island.pop.back();
+      std::cout << "Island " << ++i << ": " << best.data
+                << " (Fitness: " << best.fitness << ")" << std::endl;
+    }
+  }
+
+  return 0;
+}
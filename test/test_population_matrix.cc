@@ -0,0 +1,126 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/population_matrix.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+static constexpr size_t kLength = 8;
+using Rng = std::mt19937;
+using Matrix = snf::PopulationMatrix<double, double>;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+// Maximize 1 / (1 + sum (x_i - 0.5)^2) 0<x_i<1
+double f(snf::Span<double> value, Rng& rng) {
+  double sum = 0.0;
+  for (double it : value) {
+    sum += (it - 0.5) * (it - 0.5);
+  }
+
+  return 1.0 / (1.0 + sum);
+}
+
+// Run Ga over a matrix population and return the best fitness.
+template <typename SelectionFunc>
+double Solve(const SelectionFunc& selection, const char* name) {
+  Rng rng(1);
+  auto ga = snf::make_ga(
+      0.5, 0.8, f, selection,
+      snf::CrossoverPoint(),
+      snf::MutationVector<snf::MutationNormal<double>>(
+          0.2, snf::MutationNormal<double>(0.1, 0.0, 1.0)),
+      snf::ReplacementElitist(snf::SelectionSize(0.5)),
+      snf::TerminationGeneration(200));
+
+  Matrix pop(20, kLength);
+  std::uniform_real_distribution<double> dist;
+  for (size_t i = 0; i < pop.size(); ++i) {
+    for (double& it : pop.row(i)) {
+      it = dist(rng);
+    }
+  }
+
+  ga.Run(pop, rng);
+  snf::Evaluate(pop, f, rng);
+
+  bool layout_ok = pop.size() == 20 && pop.length() == kLength;
+  bool fitness_ok = true;
+  double best = 0.0;
+  for (size_t i = 0; i < pop.size(); ++i) {
+    fitness_ok = fitness_ok && pop.fitness()[i] == f(pop.row(i), rng);
+    best = std::max(best, pop.fitness()[i]);
+  }
+
+  std::cout << name << ": " << best << std::endl;
+  Check(layout_ok, name);
+  Check(fitness_ok, name);
+  Check(best > 0.95, name);
+  return best;
+}
+
+int main() {
+  Rng rng(1);
+
+  // FitnessRankLinear ranks the fittest individual highest.
+  snf::FitnessRankLinear rank;
+  Check(rank(0, 4) == 4.0 && rank(3, 4) == 1.0, "linear rank");
+
+  // Moving a matrix leaves the source empty, as ReplacementAll relies on.
+  {
+    Matrix src(3, kLength), dst;
+    src.set_fitness(1, 0.5);
+    snf::ReplacementAll()(src, dst, rng);
+    Check(src.empty() && src.begin() == src.end() && dst.size() == 3 &&
+              dst.fitness()[1] == 0.5,
+          "move assignment");
+
+    Matrix moved(std::move(dst));
+    Check(dst.empty() && moved.size() == 3, "move construction");
+    dst.push_back(moved[1]);
+    Check(dst.size() == 1 && dst.fitness()[0] == 0.5, "reuse after move");
+  }
+
+  // Appending a row of the same matrix survives the reallocation.
+  {
+    Matrix pop(1, kLength);
+    pop.row(0)[0] = 1.0;
+    pop.set_fitness(0, 0.25);
+    for (int i = 0; i < 10; ++i) {
+      pop.push_back(pop[pop.size() - 1]);
+    }
+
+    bool copied = pop.size() == 11;
+    for (size_t i = 0; i < pop.size(); ++i) {
+      copied = copied && pop.row(i)[0] == 1.0 && pop.fitness()[i] == 0.25 &&
+               !pop.dirty()[i];
+    }
+
+    Check(copied, "push_back self");
+  }
+
+  Solve(snf::SelectionTournament(snf::SelectionSize(0.5), 2), "tournament");
+  Solve(snf::SelectionSus(snf::SelectionSize(0.5)), "sus");
+  Solve(snf::SelectionRank<snf::SelectionSus, snf::FitnessRankLinear>(
+            snf::SelectionSus(snf::SelectionSize(0.5))),
+        "rank");
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "metasinf/random.h"
+
+using Rng = snf::Philox4x32;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+// Return whether `count` successes out of `trials` lie within five standard
+// deviations of the binomial mean for the success probability `prob`.
+bool Binomial(size_t count, size_t trials, double prob) {
+  double mean = trials * prob;
+  return std::abs(count - mean) <= 5.0 * std::sqrt(mean * (1.0 - prob)) + 1e-9;
+}
+
+// Random123 known-answer vectors for Philox4x32-10.
+struct KnownAnswer {
+  uint32_t counter[4];
+  uint32_t key[2];
+  uint32_t result[4];
+};
+
+static const KnownAnswer kKnownAnswers[] = {
+    {{0x00000000, 0x00000000, 0x00000000, 0x00000000},
+     {0x00000000, 0x00000000},
+     {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+    {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+     {0xffffffff, 0xffffffff},
+     {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+    {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+     {0xa4093822, 0x299f31d0},
+     {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+};
+
+std::vector<uint32_t> Draw(Rng& rng, size_t count) {
+  std::vector<uint32_t> result(count);
+  for (auto& it : result) {
+    it = rng();
+  }
+
+  return result;
+}
+
+int main() {
+  for (const auto& it : kKnownAnswers) {
+    uint32_t counter[4] = {it.counter[0], it.counter[1], it.counter[2],
+                           it.counter[3]};
+    Rng::Philox(counter, it.key);
+    Check(std::equal(counter, counter + 4, it.result), "known answer");
+  }
+
+  // The generator draws the blocks of its stream in order: block i of
+  // seed k and stream s is the bijection of the counter (i, s) under k.
+  {
+    Rng rng(0, 0);
+    Check(Draw(rng, 4) == std::vector<uint32_t>(kKnownAnswers[0].result,
+                                                kKnownAnswers[0].result + 4),
+          "stream layout");
+
+    uint32_t counter[4] = {5, 0, 0x13198a2e, 0x03707344};
+    const uint32_t key[2] = {0xa4093822, 0x299f31d0};
+    Rng::Philox(counter, key);
+    Rng seeker(0x299f31d0a4093822ULL, 0x0370734413198a2eULL);
+    seeker.seek(4 * 5);
+    Check(Draw(seeker, 4) == std::vector<uint32_t>(counter, counter + 4),
+          "block layout");
+  }
+
+  // Fill matches scalar draws at every alignment and length.
+  for (size_t offset = 0; offset < 5; ++offset) {
+    for (size_t count : {0, 1, 3, 31, 32, 33, 100}) {
+      Rng rng0(42, 7);
+      Rng rng1(42, 7);
+      rng0.discard(offset);
+      rng1.discard(offset);
+
+      std::vector<uint32_t> filled(count);
+      rng0.Fill(filled.data(), count);
+      Check(filled == Draw(rng1, count) && rng0 == rng1 &&
+                rng0() == rng1(),
+            "fill");
+    }
+  }
+
+  // Seeking and discarding land on the same outputs as drawing.
+  {
+    Rng rng(5);
+    std::vector<uint32_t> outputs = Draw(rng, 64);
+
+    Rng seeker(5);
+    seeker.seek(37);
+    Check(seeker.position() == 37 && seeker() == outputs[37], "seek");
+    seeker.seek(2);
+    Check(seeker() == outputs[2], "seek back");
+    seeker.discard(10);
+    Check(seeker.position() == 13 && seeker() == outputs[13], "discard");
+  }
+
+  // Substreams depend on their id and the parent stream only.
+  {
+    Rng rng(9);
+    Rng sub0 = rng.Substream(1);
+    Draw(rng, 10);
+    Rng sub1 = rng.Substream(1);
+    Rng other = rng.Substream(2);
+    Check(sub0 == sub1 && sub0.position() == 0, "substream position");
+    Check(Draw(sub0, 8) == Draw(sub1, 8), "substream outputs");
+    Check(Draw(other, 8) != Draw(sub1, 8), "distinct substreams");
+    Check(rng.position() == 10, "substream leaves parent");
+
+    Rng nested0 = Rng(9).Substream(1).Substream(3);
+    Rng nested1 = Rng(9).Substream(1).Substream(3);
+    Check(nested0 == nested1 && Draw(nested0, 4) != Draw(sub0, 4),
+          "nested substreams");
+  }
+
+  // Copies, seed sequences and the stream operators.
+  {
+    Rng rng(3, 4);
+    rng.discard(6);
+    Rng copy(rng);
+    Check(copy == rng && copy() == rng(), "copy");
+
+    std::seed_seq seq{1, 2, 3};
+    Rng seeded(seq);
+    std::seed_seq same{1, 2, 3};
+    Rng reseeded;
+    reseeded.seed(same);
+    Check(seeded == reseeded, "seed sequence");
+
+    std::stringstream stream;
+    stream << rng;
+    Rng restored;
+    stream >> restored;
+    Check(restored == rng && restored() == rng(), "stream operators");
+  }
+
+  // Bernoulli sampling, in both regimes and at their boundary: the indices
+  // are appended in ascending order, and the number of successes overall
+  // and within each tenth of the trials is within five standard deviations
+  // of its mean.
+  {
+    Rng rng(9);
+    const size_t kCount = 1001;
+    const int kRounds = 1000;
+    for (double prob : {0.0, 0.003, 0.05, 0.125, 0.3, 0.5, 0.77, 0.999, 1.0}) {
+      std::vector<size_t> indices;
+      std::vector<size_t> bins(10);
+      size_t total = 0;
+      bool order_ok = true;
+      for (int round = 0; round < kRounds; ++round) {
+        indices.assign(1, kCount);
+        snf::SampleBernoulli(prob, kCount, indices, rng);
+        for (size_t i = 1; i < indices.size(); ++i) {
+          order_ok = order_ok && indices[i] < kCount &&
+                     (i == 1 || indices[i - 1] < indices[i]);
+          if (indices[i] < kCount) {
+            ++bins[indices[i] * bins.size() / kCount];
+          }
+        }
+
+        total += indices.size() - 1;
+      }
+
+      bool counts_ok = Binomial(total, kCount * kRounds, prob);
+      for (size_t i = 0; i < bins.size(); ++i) {
+        size_t first = (i * kCount + bins.size() - 1) / bins.size();
+        size_t last = ((i + 1) * kCount + bins.size() - 1) / bins.size();
+        counts_ok = counts_ok && Binomial(bins[i], (last - first) * kRounds,
+                                          prob);
+      }
+
+      Check(indices[0] == kCount && order_ok, "Bernoulli order");
+      Check(counts_ok, "Bernoulli counts");
+    }
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/termination.h"
+
+using Rng = std::mt19937;
+using Pop = snf::Population<double, double>;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+// Return whether `count` successes out of `trials` lie within five standard
+// deviations of the binomial mean for the success probability `prob`.
+bool Binomial(size_t count, size_t trials, double prob) {
+  double mean = trials * prob;
+  return std::abs(count - mean) <= 5.0 * std::sqrt(mean * (1.0 - prob)) + 1e-9;
+}
+
+// Return whether the frequencies of the drawn indices match the weights.
+bool Frequencies(const std::vector<size_t>& draws,
+                 const std::vector<double>& weights) {
+  double total = 0.0;
+  for (double it : weights) {
+    total += it;
+  }
+
+  std::vector<size_t> counts(weights.size());
+  for (size_t it : draws) {
+    if (it >= counts.size()) {
+      return false;
+    }
+
+    ++counts[it];
+  }
+
+  bool result = true;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    double prob = total > 0.0 ? weights[i] / total : 1.0 / weights.size();
+    result = result && Binomial(counts[i], draws.size(), prob);
+  }
+
+  return result;
+}
+
+// Selection without a selection plan: copy the fittest individuals.
+struct SelectionBest {
+  explicit SelectionBest(size_t count) : count(count) {}
+
+  size_t count;
+
+  template <typename P, typename R>
+  void operator()(P& src, P& dst, R& rng) {
+    P sorted = src;
+    std::sort(sorted.begin(), sorted.end(), std::greater<Individual>());
+    for (size_t i = 0; i < count && i < sorted.size(); ++i) {
+      dst.push_back(sorted[i]);
+    }
+  }
+
+ private:
+  using Individual = snf::Individual<double, double>;
+};
+
+using RankSus = snf::SelectionRank<snf::SelectionSus>;
+using RankBest = snf::SelectionRank<SelectionBest>;
+using SigmaSus = snf::SelectionSigma<snf::SelectionSus>;
+using SigmaBest = snf::SelectionSigma<SelectionBest>;
+
+static_assert(snf::HasSelectionPlan<RankSus, Pop, Rng>::value,
+              "SelectionRank plans when the wrapped selection does");
+static_assert(!snf::HasSelectionPlan<RankBest, Pop, Rng>::value,
+              "SelectionRank does not plan without a wrapped plan");
+static_assert(snf::HasSelectionPlan<SigmaSus, Pop, Rng>::value,
+              "SelectionSigma plans when the wrapped selection does");
+static_assert(!snf::HasSelectionPlan<SigmaBest, Pop, Rng>::value,
+              "SelectionSigma does not plan without a wrapped plan");
+
+// Maximize y = sin^6(4x) 0<x<1
+double f(double& value, Rng& rng) {
+  return std::pow(std::sin(4.0 * value), 6);
+}
+
+template <typename SelectionFunc>
+void CheckGa(const SelectionFunc& selection, const char* name) {
+  Rng rng(1);
+  auto ga = snf::make_ga(
+      0.2, 0.8, f, selection,
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementElitist(snf::SelectionSize(0.6)),
+      snf::TerminationGeneration(50));
+
+  Pop pop(20);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    it.data = dist(rng);
+  }
+
+  ga.Run(pop, rng);
+  snf::Evaluate(pop, f, rng);
+  double best = std::max_element(pop.begin(), pop.end())->fitness;
+  std::cout << name << ": " << best << std::endl;
+  Check(best > 0.9, name);
+}
+
+int main() {
+  Rng rng(1);
+  Pop pop;
+  for (int i = 0; i < 10; ++i) {
+    pop.emplace_back(i, 0.1 * (i + 1));
+  }
+
+  // The copying path selects on the scaled fitness, and the selected
+  // individuals must be evaluated again.
+  Pop dst;
+  RankBest(SelectionBest(3))(pop, dst, rng);
+  Check(dst.size() == 3 && dst[0].data == 9 && dst[1].data == 8 &&
+            dst[2].data == 7 && dst[0].is_dirty(),
+        "rank without plan");
+
+  dst.clear();
+  SigmaBest(SelectionBest(3))(pop, dst, rng);
+  Check(dst.size() == 3 && dst[0].data == 9 && dst[0].is_dirty(),
+        "sigma without plan");
+
+  // The planning path keeps the fitness of the selected individuals.
+  dst.clear();
+  RankSus(snf::SelectionSus(snf::SelectionSize(size_t(5))))(pop, dst, rng);
+  bool kept = dst.size() == 5;
+  for (const auto& it : dst) {
+    kept = kept && it.fitness == 0.1 * (it.data + 1);
+  }
+
+  Check(kept, "rank with plan");
+
+  // Roulette-wheel frequencies over a fixed-seed sample, including zero
+  // weights that must never be drawn.
+  {
+    const size_t kDraws = 200000;
+    std::vector<double> weights = {0.0, 1.0, 2.0, 0.5, 0.0, 7.0, 3.0, 0.25,
+                                   1.0, 4.0, 0.0, 2.5, 9.0};
+    Pop weighted;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weighted.emplace_back(static_cast<double>(i), weights[i]);
+    }
+
+    std::vector<size_t> draws;
+    snf::AliasTable table;
+    table.Build(weights.begin(), weights.end());
+    for (size_t i = 0; i < kDraws; ++i) {
+      draws.push_back(table(rng));
+    }
+
+    Check(table.size() == weights.size() && Frequencies(draws, weights),
+          "alias table frequencies");
+
+    std::vector<double> zeros(5, 0.0);
+    table.Build(zeros.begin(), zeros.end());
+    draws.clear();
+    for (size_t i = 0; i < kDraws; ++i) {
+      draws.push_back(table(rng));
+    }
+
+    Check(Frequencies(draws, zeros), "alias table zero weights");
+
+    snf::SelectionAlias alias(snf::SelectionSize(1.0));
+    draws.clear();
+    while (draws.size() < kDraws) {
+      alias.Plan(weighted, draws, rng);
+    }
+
+    Check(Frequencies(draws, weights), "alias selection frequencies");
+
+    snf::SelectionStochasticAcceptance acceptance(snf::SelectionSize(1.0));
+    draws.clear();
+    while (draws.size() < kDraws) {
+      acceptance.Plan(weighted, draws, rng);
+    }
+
+    Check(Frequencies(draws, weights), "stochastic acceptance frequencies");
+
+    for (auto& it : weighted) {
+      it.fitness = 0.0;
+    }
+
+    draws.clear();
+    while (draws.size() < kDraws) {
+      acceptance.Plan(weighted, draws, rng);
+    }
+
+    Check(Frequencies(draws, std::vector<double>(weights.size(), 0.0)),
+          "stochastic acceptance zero fitness");
+  }
+
+  CheckGa(RankSus(snf::SelectionSus(snf::SelectionSize(0.4))), "Ga rank");
+  CheckGa(RankBest(SelectionBest(8)), "Ga rank without plan");
+  CheckGa(SigmaBest(SelectionBest(8)), "Ga sigma without plan");
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
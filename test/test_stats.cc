@@ -0,0 +1,157 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "metasinf/population.h"
+#include "metasinf/population_matrix.h"
+#include "metasinf/stats.h"
+
+using Rng = std::mt19937;
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+bool Near(double lhs, double rhs, double tolerance) {
+  return std::abs(lhs - rhs) <= tolerance * std::max(1.0, std::abs(rhs));
+}
+
+// Return the statistics of the values computed in two passes, one value at
+// a time.
+snf::PopulationStats<double> Reference(const std::vector<double>& values) {
+  snf::PopulationStats<double> stats;
+  stats.count = values.size();
+  if (values.empty()) {
+    return stats;
+  }
+
+  stats.min = values[0];
+  stats.max = values[0];
+  for (size_t i = 0; i < values.size(); ++i) {
+    stats.sum += values[i];
+    stats.min = std::min(stats.min, values[i]);
+    if (values[i] > stats.max) {
+      stats.max = values[i];
+      stats.argmax = i;
+    }
+  }
+
+  stats.mean = stats.sum / values.size();
+  for (double it : values) {
+    stats.variance += (it - stats.mean) * (it - stats.mean);
+  }
+
+  stats.variance /= values.size();
+  return stats;
+}
+
+bool Matches(const snf::PopulationStats<double>& stats,
+             const snf::PopulationStats<double>& expected, double tolerance) {
+  return stats.count == expected.count && stats.min == expected.min &&
+         stats.max == expected.max && stats.argmax == expected.argmax &&
+         Near(stats.sum, expected.sum, tolerance) &&
+         Near(stats.mean, expected.mean, tolerance) &&
+         Near(stats.variance, expected.variance, tolerance);
+}
+
+int main() {
+  Rng rng(5);
+
+  // Every count up to a few rounds of the lanes, with values from a small
+  // set so that the maximum is tied within and across lanes.
+  {
+    bool exact_ok = true;
+    std::uniform_int_distribution<int> dist(0, 3);
+    for (size_t count = 0; count <= 40; ++count) {
+      for (int round = 0; round < 20; ++round) {
+        std::vector<double> values(count);
+        for (auto& it : values) {
+          it = dist(rng);
+        }
+
+        exact_ok = exact_ok && Matches(snf::ComputeStats(values.data(), count),
+                                       Reference(values), 1e-12);
+      }
+    }
+
+    Check(exact_ok, "small populations");
+  }
+
+  // The maximum in the last lane and in the remainder.
+  {
+    std::vector<double> values(19, 1.0);
+    values[7] = 2.0;
+    values[15] = 2.0;
+    Check(snf::ComputeStats(values.data(), values.size()).argmax == 7,
+          "argmax in last lane");
+
+    values[18] = 3.0;
+    Check(snf::ComputeStats(values.data(), values.size()).argmax == 18,
+          "argmax in remainder");
+  }
+
+  // Large fitness values compared to their spread.
+  {
+    std::normal_distribution<double> dist(1e9, 1.0);
+    std::vector<double> values(1001);
+    for (auto& it : values) {
+      it = dist(rng);
+    }
+
+    snf::PopulationStats<double> stats =
+        snf::ComputeStats(values.data(), values.size());
+    snf::PopulationStats<double> expected = Reference(values);
+    Check(Near(stats.mean, expected.mean, 1e-15) &&
+              Near(stats.variance, expected.variance, 1e-9),
+          "large values");
+  }
+
+  // The moments of a fixed-seed sample of N(3, 2^2), within five standard
+  // errors.
+  {
+    const size_t kCount = 100000;
+    std::normal_distribution<double> dist(3.0, 2.0);
+    std::vector<double> values(kCount);
+    for (auto& it : values) {
+      it = dist(rng);
+    }
+
+    snf::PopulationStats<double> stats =
+        snf::ComputeStats(values.data(), values.size());
+    Check(std::abs(stats.mean - 3.0) < 5.0 * 2.0 / std::sqrt(kCount),
+          "sample mean");
+    Check(std::abs(stats.std_dev() - 2.0) < 5.0 * 2.0 / std::sqrt(2 * kCount),
+          "sample standard deviation");
+    Check(Matches(stats, Reference(values), 1e-9), "sample");
+  }
+
+  // The population overloads agree with the contiguous one.
+  {
+    snf::Population<int, double> pop(37);
+    snf::PopulationMatrix<double, double> matrix(37, 2);
+    std::vector<double> values(37);
+    std::uniform_real_distribution<double> dist;
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = dist(rng);
+      pop[i].fitness = values[i];
+      matrix[i].fitness = values[i];
+    }
+
+    snf::PopulationStats<double> expected = Reference(values);
+    Check(Matches(snf::ComputeStats(pop), expected, 1e-12), "population");
+    Check(Matches(snf::ComputeStats(matrix), expected, 1e-12), "matrix");
+  }
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "metasinf/crossover.h"
+#include "metasinf/mutation.h"
+#include "metasinf/selection.h"
+#include "metasinf/steady_state_ga.h"
+#include "metasinf/termination.h"
+
+using Rng = std::mt19937;
+using Pop = snf::Population<double, double>;
+
+static_assert(snf::HasSelectionDraw<snf::SelectionTournament, Pop, Rng>::value,
+              "SelectionTournament draws single parents");
+static_assert(!snf::HasSelectionDraw<snf::SelectionSus, Pop, Rng>::value,
+              "SelectionSus only plans");
+
+static int failures = 0;
+
+void Check(bool condition, const char* name) {
+  if (!condition) {
+    std::cout << "FAILED: " << name << std::endl;
+    ++failures;
+  }
+}
+
+// Maximize y = sin^6(4x) 0<x<1
+double f(double& value, Rng& rng) {
+  return std::pow(std::sin(4.0 * value), 6);
+}
+
+Pop RandomPopulation(Rng& rng) {
+  Pop pop(20);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    it.data = dist(rng);
+  }
+
+  return pop;
+}
+
+// Check that stepping the engine gives the same population as running it,
+// whether it keeps its fitness index between steps or not.
+template <typename SelectionFunc>
+void CheckSteps(const SelectionFunc& selection, const char* name) {
+  auto ga = snf::make_steady_state_ga(
+      2, 0.2, 0.8, f, selection,
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::VictimWorst(),
+      snf::TerminationGeneration(500));
+  auto stepped = ga;
+
+  Rng rng0(7), rng1(7);
+  Pop pop0 = RandomPopulation(rng0);
+  Pop pop1 = RandomPopulation(rng1);
+  ga.Run(pop0, rng0);
+  while (!stepped(pop1, rng1)) {}
+
+  bool same = pop0.size() == pop1.size();
+  double best = 0.0;
+  for (size_t i = 0; same && i < pop0.size(); ++i) {
+    same = pop0[i].data == pop1[i].data && pop0[i].fitness == pop1[i].fitness;
+    best = std::max(best, pop0[i].fitness);
+  }
+
+  std::cout << name << ": " << best << std::endl;
+  Check(same, name);
+  Check(best > 0.99, name);
+}
+
+int main() {
+  Rng rng;
+  rng.seed(static_cast<unsigned int>(time(nullptr)));
+
+  auto ga = snf::make_steady_state_ga(
+      1, 0.2, 0.8, f,
+      snf::SelectionTournament(snf::SelectionSize(size_t(2)), 2),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::VictimWorst(),
+      snf::TerminationGeneration(10000));
+
+  Pop pop = RandomPopulation(rng);
+  ga.Run(pop, rng);
+
+  if (!pop.empty()) {
+    snf::Evaluate(pop, f, rng);
+    std::sort(pop.begin(), pop.end());
+
+    auto best = pop.back();
+    std::cout << best.data << " (Fitness: " << best.fitness << ")" << std::endl;
+  }
+
+  // The index breaks ties as FittestIndices does.
+  {
+    Pop ties;
+    for (double fitness : {1.0, 3.0, 3.0, 0.0, 0.0}) {
+      ties.emplace_back(0.0, fitness);
+    }
+
+    snf::FitnessIndex<double> index;
+    index.Build(ties);
+    std::vector<size_t> fittest;
+    snf::FittestIndices(ties, 1, fittest);
+    Check(index.best() == 2 && fittest[0] == 2 && index.worst() == 3,
+          "index ties");
+  }
+
+  CheckSteps(snf::SelectionTournament(snf::SelectionSize(size_t(2)), 2),
+             "tournament draws");
+  CheckSteps(snf::SelectionSus(snf::SelectionSize(size_t(4))), "sus plans");
+
+  std::cout << (failures == 0 ? "All checks passed" : "Checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2016-2020 Andreas Goulas
+// Licensed under the MIT license.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "metasinf/crossover.h"
+#include "metasinf/ga.h"
+#include "metasinf/mutation.h"
+#include "metasinf/replacement.h"
+#include "metasinf/selection.h"
+#include "metasinf/subprocess.h"
+#include "metasinf/termination.h"
+
+using Rng = std::mt19937;
+
+// Maximize y = sin^6(4x) 0<x<1. The evaluation occasionally crashes or
+// hangs, like an unreliable simulator.
+double f(double& value, Rng& rng) {
+  std::uniform_int_distribution<int> dist(0, 999);
+  int fault = dist(rng);
+  if (fault < 2) {
+    std::abort();
+  } else if (fault < 3) {
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+  }
+
+  return std::pow(std::sin(4.0 * value), 6);
+}
+
+int main(int argc, char** argv) {
+  if (snf::IsSubprocessWorker()) {
+    return snf::RunSubprocessWorker<double, double>(f);
+  }
+
+  Rng rng;
+  rng.seed(static_cast<unsigned int>(time(nullptr)));
+
+  snf::SubprocessPool pool({argv[0]}, 4, sizeof(double),
+                           std::chrono::milliseconds(200));
+
+  auto ga = snf::make_ga(
+      0.2, 0.8, snf::make_evaluation_subprocess(pool),
+      snf::SelectionSus(snf::SelectionSize(0.4)),
+      snf::CrossoverSbx<double>(3.0),
+      snf::MutationNormal<double>(0.5, 0.0, 1.0),
+      snf::ReplacementElitist(snf::SelectionSize(0.6)),
+      snf::TerminationGeneration(100));
+
+  snf::Population<double, double> pop(20);
+  for (auto& it : pop) {
+    std::uniform_real_distribution<double> dist;
+    it.data = dist(rng);
+  }
+
+  ga.Run(pop, rng);
+
+  if (!pop.empty()) {
+    snf::Evaluate(pop, ga.evaluation, rng);
+    std::sort(pop.begin(), pop.end());
+
+    auto best = pop.back();
+    std::cout << best.data << " (Fitness: " << best.fitness << ")" << std::endl;
+  }
+
+  std::cout << "Restarts: " << pool.restarts()
+            << ", Timeouts: " << pool.timeouts() << std::endl;
+  return 0;
+}